@@ -0,0 +1,208 @@
+#include "aac.h"
+#include "morton.h"
+#include "nodearena.h"
+#include "parallel.h"
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <new>
+#include <numeric>
+
+// Ranges smaller than this are built on the current thread
+#define AAC_MIN_PARALLEL_RANGE 4096
+
+// A cluster and the internal node slot it owns. Merging two clusters places the parent in
+// the slot of the one that disappears, so disjoint ranges never share a slot and threads
+// need no allocator.
+struct AACCluster {
+    TreeNode* node;
+    int slot;
+};
+
+struct AACBuilder {
+    const std::vector<uint64_t>& codes;
+    TreeNode* internals;
+    int bucketSize;
+    float epsilon;
+    int parallelDepth; // Levels that build their halves on separate threads
+};
+
+// Clusters a range of n objects is reduced to before its parent sees them
+static int ReducedCount(const AACBuilder& builder, int n) {
+    float scale = std::pow(static_cast<float>(builder.bucketSize), 0.5f + builder.epsilon) * 0.5f;
+    return std::max(1, static_cast<int>(std::ceil(scale * std::pow(static_cast<float>(n), 0.5f - builder.epsilon))));
+}
+
+// Greedily merges the pair with the lowest MergeCost until at most target clusters remain
+static void CombineClusters(const AACBuilder& builder, std::vector<AACCluster>& clusters, int target) {
+    int count = static_cast<int>(clusters.size());
+    if (count <= target || BuildCancelled()) return; // A cancelled build must not fill the matrix for every leaf
+
+    // Full cost matrix plus each cluster's cheapest partner
+    const size_t stride = count;
+    std::vector<float> costs(stride * stride);
+    std::vector<int> best(count);
+    std::vector<char> stale(count);
+    auto cost = [&](int i, int j) -> float& { return costs[i * stride + j]; };
+    auto findBest = [&](int i) {
+        float bestCost = std::numeric_limits<float>::max();
+        best[i] = i == 0 ? 1 : 0;
+        for (int j = 0; j < count; ++j) {
+            if (j != i && cost(i, j) < bestCost) {
+                bestCost = cost(i, j);
+                best[i] = j;
+            }
+        }
+        };
+    for (int i = 0; i < count; ++i) {
+        for (int j = i + 1; j < count; ++j) {
+            cost(i, j) = cost(j, i) = MergeCost(clusters[i].node, clusters[j].node);
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        findBest(i);
+    }
+
+    while (count > target && !BuildCancelled()) {
+        int first = 0;
+        for (int i = 1; i < count; ++i) {
+            if (cost(i, best[i]) < cost(first, best[first])) first = i;
+        }
+        int second = best[first];
+
+        // The parent replaces first and is placed in second's slot
+        clusters[first].node = new (&builder.internals[clusters[second].slot]) TreeNode(clusters[first].node, clusters[second].node);
+        for (int i = 0; i < count; ++i) {
+            stale[i] = best[i] == first || best[i] == second;
+        }
+
+        // Move the last cluster into second's place
+        int last = count - 1;
+        if (second != last) {
+            clusters[second] = clusters[last];
+            for (int i = 0; i < last; ++i) {
+                cost(second, i) = cost(i, second) = cost(last, i);
+            }
+            best[second] = best[last];
+            stale[second] = stale[last];
+        }
+        if (first == last) first = second;
+        count = last;
+
+        for (int i = 0; i < count; ++i) {
+            if (best[i] == last) best[i] = second;
+            if (i != first) cost(first, i) = cost(i, first) = MergeCost(clusters[first].node, clusters[i].node);
+        }
+        for (int i = 0; i < count; ++i) {
+            if (i == first || stale[i]) {
+                findBest(i);
+            }
+            else if (cost(i, first) < cost(i, best[i])) {
+                best[i] = first;
+            }
+        }
+    }
+    clusters.resize(count);
+}
+
+// Builds [begin, end), whose codes agree above bit, into its reduced set of clusters
+static std::vector<AACCluster> BuildRange(const AACBuilder& builder, TreeNode* leaves, int begin, int end, int bit, int depth) {
+    int n = end - begin;
+    std::vector<AACCluster> clusters;
+    if (n < builder.bucketSize) {
+        clusters.reserve(n);
+        for (int i = begin; i < end; ++i) {
+            clusters.push_back({ &leaves[i], i });
+        }
+        CombineClusters(builder, clusters, ReducedCount(builder, builder.bucketSize));
+        return clusters;
+    }
+
+    // Split at the first code with the highest differing bit set, or in the middle once the codes run out
+    int split = begin + n / 2;
+    while (bit >= 0) {
+        uint64_t mask = 1ull << bit;
+        auto first = std::partition_point(builder.codes.begin() + begin, builder.codes.begin() + end, [mask](uint64_t code) {
+            return (code & mask) == 0;
+            });
+        int index = static_cast<int>(first - builder.codes.begin());
+        --bit;
+        if (index != begin && index != end) {
+            split = index;
+            break;
+        }
+    }
+
+    std::vector<AACCluster> halves[2];
+    auto buildHalf = [&](int half) {
+        halves[half] = half == 0 ? BuildRange(builder, leaves, begin, split, bit, depth + 1)
+            : BuildRange(builder, leaves, split, end, bit, depth + 1);
+        };
+    if (depth < builder.parallelDepth && n >= AAC_MIN_PARALLEL_RANGE) {
+        // The cancel flag is thread-local, so hand the caller's to the thread building the other half
+        const std::atomic<bool>* cancelFlag = buildCancelFlag;
+        ParallelForChunks(0, 2, 2, [&](int half, int, int) {
+            buildCancelFlag = cancelFlag;
+            buildHalf(half);
+            });
+    }
+    else {
+        buildHalf(0);
+        buildHalf(1);
+    }
+
+    clusters = std::move(halves[0]);
+    clusters.insert(clusters.end(), halves[1].begin(), halves[1].end());
+    CombineClusters(builder, clusters, ReducedCount(builder, n));
+    return clusters;
+}
+
+TreeNode* AACTree(NodeArena& arena, const std::vector<Object>& objects, AACMode mode) {
+    int n = static_cast<int>(objects.size());
+    if (n == 0) return nullptr;
+
+    // Sort object centers along the Morton curve
+    std::vector<glm::vec3> centers(n);
+    AABB centerBounds;
+    centerBounds.min = glm::vec3(std::numeric_limits<float>::max());
+    centerBounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (int i = 0; i < n; ++i) {
+        centers[i] = (objects[i].boundingBox.min + objects[i].boundingBox.max) * 0.5f;
+        centerBounds.min = glm::min(centerBounds.min, centers[i]);
+        centerBounds.max = glm::max(centerBounds.max, centers[i]);
+    }
+
+    std::vector<uint64_t> codes;
+    ComputeMortonCodes(centers, centerBounds, 63, codes);
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    RadixSortPairs(codes, order, 63);
+
+    // One internal slot per leaf: n - 1 merges free n - 1 slots, and one is never used
+    TreeNode* internals = arena.NewArray(2 * static_cast<size_t>(n));
+    TreeNode* leaves = internals + n;
+    ParallelFor(0, n, [&](int i) {
+        const Object& obj = objects[order[i]];
+        TreeNode* leaf = &leaves[i];
+        leaf->aabbVolume = obj.boundingBox;
+        leaf->ritterVolume = obj.ritterSphere;
+        leaf->larssonVolume = obj.larssonSphere;
+        leaf->pcaVolume = obj.pcaSphere;
+        leaf->objects = const_cast<Object*>(&obj);
+        leaf->numObjects = 1;
+        });
+
+    AACBuilder builder{ codes, internals,
+        mode == AAC_FAST ? AAC_FAST_BUCKET : AAC_HQ_BUCKET,
+        mode == AAC_FAST ? AAC_FAST_EPSILON : AAC_HQ_EPSILON,
+        static_cast<int>(std::bit_width(static_cast<unsigned>(NumWorkerThreads() - 1))) };
+    std::vector<AACCluster> clusters = BuildRange(builder, leaves, 0, n, 62, 0);
+    CombineClusters(builder, clusters, 1);
+
+    // A cancelled build chains what is left so the arena still holds one tree
+    TreeNode* root = clusters[0].node;
+    for (size_t i = 1; i < clusters.size(); ++i) {
+        root = arena.New(root, clusters[i].node);
+    }
+    return root;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+// Bucket size (delta) and reduction exponent (epsilon) of the two settings from the paper
+#define AAC_FAST_BUCKET 4
+#define AAC_FAST_EPSILON 0.2f
+#define AAC_HQ_BUCKET 20
+#define AAC_HQ_EPSILON 0.1f
+
+enum AACMode {
+    AAC_FAST,
+    AAC_HIGH_QUALITY
+};
+
+// Approximate agglomerative clustering (Gu et al. 2013). Object centers are sorted along a
+// Morton curve and split recursively by Morton bit until a range holds fewer than the bucket
+// size. Each level greedily merges the clusters its two halves return, by the lowest MergeCost,
+// until at most f(n) = delta^(1/2 + epsilon) / 2 * n^(1/2 - epsilon) remain, and the root
+// merges down to one. Large halves are built on separate threads.
+// Leaves point into objects, which must outlive the tree.
+TreeNode* AACTree(NodeArena& arena, const std::vector<Object>& objects, AACMode mode = AAC_HIGH_QUALITY);
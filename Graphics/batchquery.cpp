@@ -0,0 +1,100 @@
+#include "batchquery.h"
+#include "morton.h"
+#include "packet.h"
+#include "parallel.h"
+#include "raycast.h"
+#include <limits>
+#include <numeric>
+#include <vector>
+
+// Buffers one worker thread keeps across the chunks it claims, and across batches since the
+// pool's threads outlive them
+struct BatchScratch {
+    std::vector<Ray> rays;
+    std::vector<RayHit> hits;
+    std::vector<const Object*> objects;
+};
+
+// Indices of points sorted by Morton code within the points' bounds; equal codes keep their order
+static std::vector<int> MortonOrder(std::span<const glm::vec3> points) {
+    AABB bounds = { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (const auto& p : points) {
+        bounds.min = glm::min(bounds.min, p);
+        bounds.max = glm::max(bounds.max, p);
+    }
+
+    std::vector<uint64_t> codes;
+    ComputeMortonCodes(points, bounds, 30, codes);
+    std::vector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    RadixSortPairs(codes, order, 30);
+    return order;
+}
+
+static std::vector<int> RayOrder(std::span<const Ray> rays) {
+    std::vector<glm::vec3> origins(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i) {
+        origins[i] = rays[i].start;
+    }
+    return MortonOrder(origins);
+}
+
+// Calls fn(queries, scratch) for each chunk of order on whichever worker thread claims it
+template <typename Fn>
+static void RunChunks(const std::vector<int>& order, Fn fn) {
+    ParallelForDynamic(0, static_cast<int>(order.size()), BATCH_CHUNK_SIZE, [&](int begin, int end, int) {
+        thread_local BatchScratch scratch;
+        fn(std::span<const int>(order.data() + begin, end - begin), scratch);
+        });
+}
+
+void BatchRayCast(const FlatBVH& bvh, std::span<const Ray> rays, float tMax, std::span<RayHit> hits) {
+    RunChunks(RayOrder(rays), [&](std::span<const int> queries, BatchScratch& scratch) {
+        // Packets need their rays side by side, so each chunk is gathered first
+        scratch.rays.resize(queries.size());
+        scratch.hits.resize(queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            scratch.rays[i] = rays[queries[i]];
+        }
+        RayCastPackets(bvh, scratch.rays, tMax, scratch.hits);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            hits[queries[i]] = scratch.hits[i];
+        }
+        });
+}
+
+void BatchRayOccluded(const FlatBVH& bvh, std::span<const Ray> rays, float tMax, std::span<uint8_t> occluded) {
+    RunChunks(RayOrder(rays), [&](std::span<const int> queries, BatchScratch&) {
+        for (int query : queries) {
+            occluded[query] = RayOccluded(bvh, rays[query], tMax);
+        }
+        });
+}
+
+void BatchOverlap(const FlatBVH& bvh, std::span<const AABB> boxes, std::span<int> counts) {
+    std::vector<glm::vec3> centers(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        centers[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+    }
+    RunChunks(MortonOrder(centers), [&](std::span<const int> queries, BatchScratch& scratch) {
+        for (int query : queries) {
+            scratch.objects.clear();
+            FlatOverlap(bvh, boxes[query], scratch.objects);
+            counts[query] = static_cast<int>(scratch.objects.size());
+        }
+        });
+}
+
+void BatchOverlap(const FlatBVH& bvh, std::span<const BoundingSphere> spheres, BoundingVolumeType bvType, std::span<int> counts) {
+    std::vector<glm::vec3> centers(spheres.size());
+    for (size_t i = 0; i < spheres.size(); ++i) {
+        centers[i] = spheres[i].center;
+    }
+    RunChunks(MortonOrder(centers), [&](std::span<const int> queries, BatchScratch& scratch) {
+        for (int query : queries) {
+            scratch.objects.clear();
+            FlatOverlap(bvh, spheres[query], bvType, scratch.objects);
+            counts[query] = static_cast<int>(scratch.objects.size());
+        }
+        });
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include "bvh.h"
+#include "blas.h"
+#include "flatbvh.h"
+
+// Queries a worker thread claims at a time
+#define BATCH_CHUNK_SIZE 256
+
+// Batches of independent queries spread across the worker threads. Queries are taken in
+// order of the Morton code of their ray origin or volume center, so each thread's
+// consecutive queries visit mostly the same nodes, and every result is written to the
+// caller's array at the query's own index. The threads persist between batches, and each
+// reuses one set of scratch buffers for every chunk it claims.
+
+// Closest hits, traced as packets where neighbouring rays are coherent; hits[i].object is
+// null when ray i misses
+void BatchRayCast(const FlatBVH& bvh, std::span<const Ray> rays, float tMax, std::span<RayHit> hits);
+// occluded[i] is 1 when ray i hits a triangle closer than tMax, else 0
+void BatchRayOccluded(const FlatBVH& bvh, std::span<const Ray> rays, float tMax, std::span<uint8_t> occluded);
+// counts[i] is the number of objects FlatOverlap finds for volume i
+void BatchOverlap(const FlatBVH& bvh, std::span<const AABB> boxes, std::span<int> counts);
+void BatchOverlap(const FlatBVH& bvh, std::span<const BoundingSphere> spheres, BoundingVolumeType bvType, std::span<int> counts);
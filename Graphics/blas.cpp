@@ -0,0 +1,301 @@
+#include "blas.h"
+#include "childtests.h"
+#include <algorithm>
+#include <limits>
+
+struct BLASBuilder {
+    std::vector<AABB> bounds;          // Per source triangle
+    std::vector<glm::vec3> centroids;  // Per source triangle
+    std::vector<int> order;            // Source triangles in leaf order
+    std::vector<BLASNode>& nodes;
+};
+
+// Entry on the traversal stack, with the distance at which the ray enters the node
+struct BLASStackEntry {
+    int node;
+    float tEntry;
+};
+
+static void Subdivide(BLASBuilder& builder, int nodeIndex, int first, int count, int depth) {
+    AABB bounds;
+    bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+    AABB centroidBounds = bounds;
+    for (int i = first; i < first + count; ++i) {
+        int tri = builder.order[i];
+        bounds = MergeAABB(bounds, builder.bounds[tri]);
+        centroidBounds.min = glm::min(centroidBounds.min, builder.centroids[tri]);
+        centroidBounds.max = glm::max(centroidBounds.max, builder.centroids[tri]);
+    }
+    builder.nodes[nodeIndex] = { bounds, first, count };
+
+    if (count <= BLAS_MAX_LEAF_SIZE || depth >= BLAS_MAX_DEPTH) {
+        return;
+    }
+
+    // Binned SAH over triangle centroids on all three axes
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    int bestBin = -1;
+    for (int axis = 0; axis < 3; ++axis) {
+        float minC = centroidBounds.min[axis];
+        float maxC = centroidBounds.max[axis];
+        if (maxC <= minC) continue;
+
+        float scale = BLAS_NUM_BINS / (maxC - minC);
+        AABB bins[BLAS_NUM_BINS];
+        int counts[BLAS_NUM_BINS] = {};
+        for (auto& bin : bins) {
+            bin.min = glm::vec3(std::numeric_limits<float>::max());
+            bin.max = glm::vec3(std::numeric_limits<float>::lowest());
+        }
+        for (int i = first; i < first + count; ++i) {
+            int tri = builder.order[i];
+            int bin = std::min(static_cast<int>((builder.centroids[tri][axis] - minC) * scale), BLAS_NUM_BINS - 1);
+            counts[bin]++;
+            bins[bin] = MergeAABB(bins[bin], builder.bounds[tri]);
+        }
+
+        float rightArea[BLAS_NUM_BINS];
+        int rightCount[BLAS_NUM_BINS];
+        AABB acc = bins[BLAS_NUM_BINS - 1];
+        int n = 0;
+        for (int i = BLAS_NUM_BINS - 1; i > 0; --i) {
+            acc = MergeAABB(acc, bins[i]);
+            n += counts[i];
+            rightArea[i] = n > 0 ? SurfaceArea(acc) : 0.0f;
+            rightCount[i] = n;
+        }
+
+        acc = bins[0];
+        n = 0;
+        for (int i = 0; i < BLAS_NUM_BINS - 1; ++i) {
+            acc = MergeAABB(acc, bins[i]);
+            n += counts[i];
+            if (n == 0 || rightCount[i + 1] == 0) continue;
+
+            float cost = SurfaceArea(acc) * n + rightArea[i + 1] * rightCount[i + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = i;
+            }
+        }
+    }
+
+    int leftCount = 0;
+    if (bestAxis >= 0) {
+        float splitCost = SAH_TRAVERSAL_COST + bestCost / SurfaceArea(bounds) * SAH_INTERSECTION_COST;
+        if (splitCost >= count * SAH_INTERSECTION_COST) {
+            return; // Testing every triangle is cheaper than splitting
+        }
+
+        float minC = centroidBounds.min[bestAxis];
+        float scale = BLAS_NUM_BINS / (centroidBounds.max[bestAxis] - minC);
+        auto mid = std::partition(builder.order.begin() + first, builder.order.begin() + first + count, [&](int tri) {
+            return std::min(static_cast<int>((builder.centroids[tri][bestAxis] - minC) * scale), BLAS_NUM_BINS - 1) <= bestBin;
+            });
+        leftCount = static_cast<int>(mid - (builder.order.begin() + first));
+    }
+    if (leftCount == 0 || leftCount == count) {
+        // Coincident centroids: split the range in half
+        leftCount = count / 2;
+    }
+
+    int leftIndex = builder.nodes.size();
+    builder.nodes.resize(builder.nodes.size() + 2);
+    builder.nodes[nodeIndex].leftFirst = leftIndex;
+    builder.nodes[nodeIndex].count = 0;
+
+    Subdivide(builder, leftIndex, first, leftCount, depth + 1);
+    Subdivide(builder, leftIndex + 1, first + leftCount, count - leftCount, depth + 1);
+}
+
+BLAS BuildBLAS(const objl::Mesh& mesh) {
+    BLAS blas;
+    std::vector<Triangle> triangles = MeshTriangles(mesh);
+    if (triangles.empty()) {
+        return blas;
+    }
+
+    BLASBuilder builder{ {}, {}, {}, blas.nodes };
+    builder.bounds.reserve(triangles.size());
+    builder.centroids.reserve(triangles.size());
+    builder.order.reserve(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        AABB bounds = TriangleAABB(triangles[i]);
+        builder.bounds.push_back(bounds);
+        builder.centroids.push_back((bounds.min + bounds.max) * 0.5f);
+        builder.order.push_back(static_cast<int>(i));
+    }
+
+    blas.nodes.reserve(2 * triangles.size() / BLAS_MAX_LEAF_SIZE + 1);
+    blas.nodes.emplace_back();
+    Subdivide(builder, 0, 0, triangles.size(), 0);
+
+    blas.triangles.reserve(triangles.size());
+    for (int tri : builder.order) {
+        blas.triangles.push_back(triangles[tri]);
+    }
+    blas.triangleIds = std::move(builder.order);
+
+    return blas;
+}
+
+bool BLASRayCast(const BLAS& blas, const Ray& ray, float& tMax, int& triangle, float& u, float& v) {
+    if (blas.nodes.empty()) return false;
+
+    glm::vec3 invDir = 1.0f / ray.direction;
+    BLASStackEntry stack[2 * BLAS_MAX_DEPTH + 2];
+    int top = 0;
+    bool found = false;
+
+    float tEntry;
+    if (!RayIntersectsAABB(ray, invDir, blas.nodes[0].bounds, tMax, tEntry)) return false;
+    stack[top++] = { 0, tEntry };
+
+    while (top > 0) {
+        BLASStackEntry entry = stack[--top];
+        if (entry.tEntry > tMax) continue; // A closer hit was found since this node was pushed
+
+        const BLASNode& node = blas.nodes[entry.node];
+        if (node.count > 0) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                float t, hitU, hitV;
+                if (IntersectRayTriangle(ray, blas.triangles[i], tMax, t, hitU, hitV)) {
+                    tMax = t;
+                    triangle = blas.triangleIds[i];
+                    u = hitU;
+                    v = hitV;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited next
+        float tLeft, tRight;
+        bool hitLeft = RayIntersectsAABB(ray, invDir, blas.nodes[node.leftFirst].bounds, tMax, tLeft);
+        bool hitRight = RayIntersectsAABB(ray, invDir, blas.nodes[node.leftFirst + 1].bounds, tMax, tRight);
+        if (hitLeft && hitRight) {
+            bool leftFirst = tLeft <= tRight;
+            stack[top++] = leftFirst ? BLASStackEntry{ node.leftFirst + 1, tRight } : BLASStackEntry{ node.leftFirst, tLeft };
+            stack[top++] = leftFirst ? BLASStackEntry{ node.leftFirst, tLeft } : BLASStackEntry{ node.leftFirst + 1, tRight };
+        }
+        else if (hitLeft) {
+            stack[top++] = { node.leftFirst, tLeft };
+        }
+        else if (hitRight) {
+            stack[top++] = { node.leftFirst + 1, tRight };
+        }
+    }
+
+    return found;
+}
+
+bool BLASOccluded(const BLAS& blas, const Ray& ray, float tMax) {
+    if (blas.nodes.empty()) return false;
+
+    glm::vec3 invDir = 1.0f / ray.direction;
+    int stack[2 * BLAS_MAX_DEPTH + 2];
+    int top = 0;
+    stack[top++] = 0;
+
+    // Any hit will do, so children are visited in storage order
+    while (top > 0) {
+        const BLASNode& node = blas.nodes[stack[--top]];
+        float tEntry;
+        if (!RayIntersectsAABB(ray, invDir, node.bounds, tMax, tEntry)) continue;
+
+        if (node.count > 0) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                float t, u, v;
+                if (IntersectRayTriangle(ray, blas.triangles[i], tMax, t, u, v)) return true;
+            }
+            continue;
+        }
+        stack[top++] = node.leftFirst + 1;
+        stack[top++] = node.leftFirst;
+    }
+    return false;
+}
+
+bool BLASOverlaps(const BLAS& blas, const AABB& box) {
+    if (blas.nodes.empty()) return false;
+
+    int stack[2 * BLAS_MAX_DEPTH + 2];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BLASNode& node = blas.nodes[stack[--top]];
+        if (!AABBOverlap(node.bounds, box)) continue;
+
+        if (node.count > 0) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                if (TriangleAABBOverlap(blas.triangles[i], box)) return true;
+            }
+            continue;
+        }
+        stack[top++] = node.leftFirst + 1;
+        stack[top++] = node.leftFirst;
+    }
+
+    return false;
+}
+
+static void RayCastNode(const ChildTestKernels& kernels, TreeNode* node, const Ray& ray, const glm::vec3& invDir, float& tMax, RayHit& hit, bool& found) {
+    if (node->type == LEAF) {
+        for (int i = 0; i < node->numObjects; ++i) {
+            const Object& obj = node->LeafObject(i);
+            int triangle;
+            float u, v;
+            if (obj.blas && BLASRayCast(*obj.blas, ray, tMax, triangle, u, v)) {
+                hit = { &obj, triangle, tMax, u, v };
+                found = true;
+            }
+        }
+        return;
+    }
+
+    // Nearest children first, so later ones are skipped once a closer hit is found
+    ChildHits hits;
+    kernels.ray(*node, ray, invDir, tMax, hits);
+    for (int i = 0; i < hits.count; ++i) {
+        if (hits.tEntry[i] > tMax) break;
+        RayCastNode(kernels, node->children[hits.order[i]], ray, invDir, tMax, hit, found);
+    }
+}
+
+bool RayCastTree(TreeNode* root, const Ray& ray, float tMax, RayHit& hit) {
+    bool found = false;
+    glm::vec3 invDir = 1.0f / ray.direction;
+    float tEntry;
+    if (root && RayIntersectsAABB(ray, invDir, root->aabbVolume, tMax, tEntry)) {
+        RayCastNode(ActiveChildTests(), root, ray, invDir, tMax, hit, found);
+    }
+    return found;
+}
+
+static void OverlapNode(const ChildTestKernels& kernels, TreeNode* node, const AABB& box, std::vector<const Object*>& results) {
+    if (node->type == LEAF) {
+        for (int i = 0; i < node->numObjects; ++i) {
+            const Object& obj = node->LeafObject(i);
+            if (AABBOverlap(obj.boundingBox, box) && obj.blas && BLASOverlaps(*obj.blas, box)) {
+                results.push_back(&obj);
+            }
+        }
+        return;
+    }
+
+    int mask = kernels.box(*node, box);
+    for (int i = 0; i < node->numChildren; ++i) {
+        if (mask & (1 << i)) OverlapNode(kernels, node->children[i], box, results);
+    }
+}
+
+void OverlapTree(TreeNode* root, const AABB& box, std::vector<const Object*>& results) {
+    if (root && AABBOverlap(root->aabbVolume, box)) {
+        OverlapNode(ActiveChildTests(), root, box, results);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+#define BLAS_MAX_LEAF_SIZE 4
+#define BLAS_NUM_BINS 12
+#define BLAS_MAX_DEPTH 64
+
+// Flat triangle BVH node. Internal nodes keep their children at leftFirst and
+// leftFirst + 1; leaves cover triangles[leftFirst, leftFirst + count).
+struct BLASNode {
+    AABB bounds;
+    int leftFirst;
+    int count; // 0 for internal nodes
+};
+
+// Bottom-level acceleration structure over one object's triangles
+struct BLAS {
+    std::vector<Triangle> triangles; // Reordered so every leaf covers a contiguous range
+    std::vector<int> triangleIds;    // Index of each triangle in the source mesh
+    std::vector<BLASNode> nodes;     // nodes[0] is the root
+};
+
+struct RayHit {
+    const Object* object;
+    int triangle; // Index of the triangle in the object's mesh
+    float t;
+    float u, v;   // Barycentrics of the hit point
+};
+
+BLAS BuildBLAS(const objl::Mesh& mesh);
+
+// Closest triangle hit closer than tMax; on a hit tMax is lowered to the hit distance
+bool BLASRayCast(const BLAS& blas, const Ray& ray, float& tMax, int& triangle, float& u, float& v);
+// Whether any triangle is hit closer than tMax, stopping at the first
+bool BLASOccluded(const BLAS& blas, const Ray& ray, float tMax);
+bool BLASOverlaps(const BLAS& blas, const AABB& box);
+
+// Object BVH queries that descend into each reached object's triangle BVH for exact results
+bool RayCastTree(TreeNode* root, const Ray& ray, float tMax, RayHit& hit);
+void OverlapTree(TreeNode* root, const AABB& box, std::vector<const Object*>& results);
@@ -0,0 +1,1287 @@
+#include "bvh.h"
+#include "nodearena.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+#include <queue>
+#include <glm/gtx/norm.hpp> // for distance2
+
+thread_local const std::atomic<bool>* buildCancelFlag = nullptr;
+
+AABB MergeAABB(const AABB& a, const AABB& b) {
+    AABB result;
+    result.min = glm::min(a.min, b.min);
+    result.max = glm::max(a.max, b.max);
+    return result;
+}
+
+BoundingSphere MergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b) {
+    glm::vec3 d = b.center - a.center;
+    float dist = glm::length(d);
+
+    if (dist + b.radius <= a.radius) {
+        // Sphere b is entirely within sphere a
+        return a;
+    }
+
+    if (dist + a.radius <= b.radius) {
+        // Sphere a is entirely within sphere b
+        return b;
+    }
+
+    // Otherwise, compute the new sphere that minimally bounds both spheres
+    float newRadius = (dist + a.radius + b.radius) * 0.5f;
+    glm::vec3 newCenter = a.center;
+
+    if (dist > 0.0f) {
+        newCenter += d * ((newRadius - a.radius) / dist);
+    }
+
+    return { newCenter, newRadius };
+}
+
+void TreeNode::UpdateChildBounds() {
+    for (int i = 0; i < BVH_WIDTH; ++i) {
+        if (i < numChildren) {
+            const AABB& box = children[i]->aabbVolume;
+            childMinX[i] = box.min.x; childMinY[i] = box.min.y; childMinZ[i] = box.min.z;
+            childMaxX[i] = box.max.x; childMaxY[i] = box.max.y; childMaxZ[i] = box.max.z;
+        }
+        else {
+            childMinX[i] = childMinY[i] = childMinZ[i] = std::numeric_limits<float>::max();
+            childMaxX[i] = childMaxY[i] = childMaxZ[i] = std::numeric_limits<float>::lowest();
+        }
+    }
+}
+
+float Volume(const AABB& aabb) {
+    glm::vec3 size = aabb.max - aabb.min;
+    return size.x * size.y * size.z;
+}
+
+float SurfaceArea(const AABB& aabb) {
+    glm::vec3 size = aabb.max - aabb.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+BoundingVolumeCost CalculateBoundingVolumeCost(const TreeNode* a, const TreeNode* b) {
+    glm::vec3 centerA = (a->aabbVolume.min + a->aabbVolume.max) * 0.5f;
+    glm::vec3 centerB = (b->aabbVolume.min + b->aabbVolume.max) * 0.5f;
+    float distance = glm::distance(centerA, centerB);
+
+    AABB mergedAABB = MergeAABB(a->aabbVolume, b->aabbVolume);
+    float combinedVolume = Volume(mergedAABB);
+
+    float volumeA = Volume(a->aabbVolume);
+    float volumeB = Volume(b->aabbVolume);
+    float relativeVolumeIncrease = (combinedVolume - (volumeA + volumeB)) / (volumeA + volumeB);
+
+    return { distance, combinedVolume, relativeVolumeIncrease };
+}
+
+float MergeCost(const TreeNode* a, const TreeNode* b) {
+    BoundingVolumeCost cost = CalculateBoundingVolumeCost(a, b);
+
+    // Combine the costs into a single heuristic value
+    float combinedCost = cost.distance + cost.combinedVolume + cost.relativeVolumeIncrease;
+    // Two empty boxes give NaN, and two flat boxes whose merged box has volume give infinity
+    return std::isfinite(combinedCost) ? combinedCost : std::numeric_limits<float>::max();
+}
+
+// Every partner's box reaches at least gap plus half the node past the node's center on each
+// axis, and the merged box covers the node, so each merged extent is at least this
+static glm::vec3 MergedExtentBound(const glm::vec3& size, const glm::vec3& gap) {
+    return glm::max(size, gap + size * 0.5f);
+}
+
+float CombinedMergeCost::LowerBound(const glm::vec3& size, const glm::vec3& gap, float maxVolume) {
+    // The centers are at least the gap apart, and the relative increase is lowest for the
+    // largest partner but never below -0.5, as the merged volume covers both boxes
+    glm::vec3 extent = MergedExtentBound(size, gap);
+    float merged = extent.x * extent.y * extent.z;
+    float relativeIncrease = std::max(-0.5f, merged / (size.x * size.y * size.z + maxVolume) - 1.0f);
+    float bound = glm::length(gap) + merged + relativeIncrease;
+    return std::isfinite(bound) ? bound : std::numeric_limits<float>::max(); // Clamped like MergeCost
+}
+
+float SurfaceAreaMergeCost::LowerBound(const glm::vec3& size, const glm::vec3& gap, float) {
+    glm::vec3 extent = MergedExtentBound(size, gap);
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+float VolumeMergeCost::LowerBound(const glm::vec3& size, const glm::vec3& gap, float) {
+    glm::vec3 extent = MergedExtentBound(size, gap);
+    return extent.x * extent.y * extent.z;
+}
+
+// A node's cheapest partner when it was last searched for
+struct MergeCandidate {
+    float cost;
+    int node;
+    int partner;
+
+    bool operator>(const MergeCandidate& other) const { return cost > other.cost; }
+};
+
+// Average leaves per cell of the bottom-up builder's grid
+#define BOTTOM_UP_LEAVES_PER_CELL 4
+
+// Uniform grid over the centers of alive nodes, sized for a few leaves per cell, with a
+// pyramid of 2x2x2 blocks above it recording the largest volume centered in each block.
+// Centers outside the leaves' center bounds are clamped into the border cells.
+struct CenterGrid {
+    glm::vec3 origin;
+    float cellSize;
+    std::vector<glm::ivec3> dims;              // Blocks along each axis per level; level 0 is the cells
+    std::vector<std::vector<float>> maxVolume; // Per level and block; -1 when the block is empty
+    std::vector<std::vector<int>> cells;       // Alive nodes centered in each cell
+};
+
+// Block waiting to be searched, by the lowest cost any node centered in it could have
+struct BlockVisit {
+    float bound;
+    int level;
+    glm::ivec3 coords;
+
+    bool operator>(const BlockVisit& other) const { return bound > other.bound; }
+};
+
+struct AgglomerativeState {
+    std::vector<TreeNode*> nodes;   // Leaves, then merged nodes in creation order
+    std::vector<bool> alive;        // Not yet merged into a parent
+    std::vector<float> volume;      // Volume of each node's AABB
+    std::vector<glm::ivec3> cell;   // Grid cell each alive node is listed in
+    CenterGrid grid;
+    std::vector<BlockVisit> frontier; // Search scratch space
+};
+
+static glm::ivec3 GridCoords(const CenterGrid& grid, const TreeNode* node) {
+    glm::vec3 center = (node->aabbVolume.min + node->aabbVolume.max) * 0.5f;
+    glm::ivec3 coords((center - grid.origin) / grid.cellSize);
+    return glm::clamp(coords, glm::ivec3(0), grid.dims[0] - 1);
+}
+
+static int BlockIndex(const CenterGrid& grid, int level, const glm::ivec3& coords) {
+    const glm::ivec3& dims = grid.dims[level];
+    return (coords.z * dims.y + coords.y) * dims.x + coords.x;
+}
+
+// Recomputes the largest volume of a cell after a node enters or leaves it, then of the blocks above
+static void RefreshMaxVolume(AgglomerativeState& state, glm::ivec3 coords) {
+    CenterGrid& grid = state.grid;
+    float maxVolume = -1.0f;
+    for (int index : grid.cells[BlockIndex(grid, 0, coords)]) {
+        maxVolume = std::max(maxVolume, state.volume[index]);
+    }
+
+    for (int level = 0; level < static_cast<int>(grid.dims.size()); ++level) {
+        float& stored = grid.maxVolume[level][BlockIndex(grid, level, coords)];
+        if (stored == maxVolume) break;
+        stored = maxVolume;
+        if (level + 1 == static_cast<int>(grid.dims.size())) break;
+
+        coords /= 2;
+        glm::ivec3 last = glm::min(coords * 2 + 1, grid.dims[level] - 1);
+        maxVolume = -1.0f;
+        for (int z = coords.z * 2; z <= last.z; ++z) {
+            for (int y = coords.y * 2; y <= last.y; ++y) {
+                for (int x = coords.x * 2; x <= last.x; ++x) {
+                    maxVolume = std::max(maxVolume, grid.maxVolume[level][BlockIndex(grid, level, { x, y, z })]);
+                }
+            }
+        }
+    }
+}
+
+// Cheapest alive partner for a node, by best-first search down the block pyramid. A partner
+// centered in a block is at least the gap to the block away on every axis (clamping never
+// brings centers closer) and no larger than the block's largest volume, which bounds its cost
+// from below. Every unsearched node lies in a queued block, so the search is exact once the
+// lowest queued bound exceeds the best cost found. A radius leaves out cells more than that
+// many cells away on any axis, unless no partner lies within it.
+template <typename CostPolicy>
+static MergeCandidate FindBestPartner(AgglomerativeState& state, int node, int radius) {
+    const CenterGrid& grid = state.grid;
+    const TreeNode* a = state.nodes[node];
+    glm::vec3 size = a->aabbVolume.max - a->aabbVolume.min;
+    glm::vec3 center = (a->aabbVolume.min + a->aabbVolume.max) * 0.5f;
+    glm::vec3 local = glm::clamp(center - grid.origin, glm::vec3(0.0f), glm::vec3(grid.dims[0]) * grid.cellSize);
+    glm::ivec3 c = state.cell[node];
+
+    auto lowerBound = [&](int level, const glm::ivec3& coords) {
+        float blockSize = std::ldexp(grid.cellSize, level);
+        glm::vec3 blockMin = glm::vec3(coords) * blockSize;
+        glm::vec3 gap = glm::max(glm::max(blockMin - local, local - (blockMin + blockSize)), glm::vec3(0.0f));
+        return CostPolicy::LowerBound(size, gap, grid.maxVolume[level][BlockIndex(grid, level, coords)]);
+        };
+    auto inRadius = [&](int level, const glm::ivec3& coords) {
+        glm::ivec3 first = coords * (1 << level);
+        glm::ivec3 last = first + (1 << level) - 1;
+        return radius <= 0 || (glm::all(glm::lessThanEqual(first, c + radius)) && glm::all(glm::greaterThanEqual(last, c - radius)));
+        };
+
+    // Infinity, so even partners whose cost is clamped to the float maximum are searched
+    MergeCandidate best{ std::numeric_limits<float>::infinity(), node, -1 };
+    std::vector<BlockVisit>& frontier = state.frontier;
+    int top = static_cast<int>(grid.dims.size()) - 1;
+    frontier.assign(1, { lowerBound(top, glm::ivec3(0)), top, glm::ivec3(0) });
+
+    auto searchCell = [&](const glm::ivec3& coords) {
+        for (int partner : grid.cells[BlockIndex(grid, 0, coords)]) {
+            if (partner == node) continue;
+            float cost = CostPolicy::Cost(a, state.nodes[partner]);
+            if (best.partner < 0 || cost < best.cost || (cost == best.cost && partner < best.partner)) {
+                best.cost = cost;
+                best.partner = partner;
+            }
+        }
+        };
+
+    while (!frontier.empty() && frontier.front().bound <= best.cost) {
+        std::pop_heap(frontier.begin(), frontier.end(), std::greater<BlockVisit>());
+        BlockVisit block = frontier.back();
+        frontier.pop_back();
+        if (block.level == 0) {
+            searchCell(block.coords);
+            continue;
+        }
+
+        // Cells hold only a few nodes, so they are searched on the spot rather than queued
+        int level = block.level - 1;
+        glm::ivec3 last = glm::min(block.coords * 2 + 1, grid.dims[level] - 1);
+        for (int z = block.coords.z * 2; z <= last.z; ++z) {
+            for (int y = block.coords.y * 2; y <= last.y; ++y) {
+                for (int x = block.coords.x * 2; x <= last.x; ++x) {
+                    glm::ivec3 coords(x, y, z);
+                    if (grid.maxVolume[level][BlockIndex(grid, level, coords)] < 0.0f || !inRadius(level, coords)) continue;
+
+                    float bound = lowerBound(level, coords);
+                    if (bound > best.cost) continue;
+                    if (level == 0) {
+                        searchCell(coords);
+                    }
+                    else {
+                        frontier.push_back({ bound, level, coords });
+                        std::push_heap(frontier.begin(), frontier.end(), std::greater<BlockVisit>());
+                    }
+                }
+            }
+        }
+    }
+
+    if (best.partner < 0 && radius > 0) {
+        return FindBestPartner<CostPolicy>(state, node, 0);
+    }
+    return best;
+}
+
+static int AddNode(AgglomerativeState& state, TreeNode* node) {
+    int index = static_cast<int>(state.nodes.size());
+    glm::ivec3 coords = GridCoords(state.grid, node);
+    state.nodes.push_back(node);
+    state.alive.push_back(true);
+    state.volume.push_back(Volume(node->aabbVolume));
+    state.cell.push_back(coords);
+    state.grid.cells[BlockIndex(state.grid, 0, coords)].push_back(index);
+    RefreshMaxVolume(state, coords);
+    return index;
+}
+
+static void RemoveNode(AgglomerativeState& state, int index) {
+    state.alive[index] = false;
+    std::vector<int>& cell = state.grid.cells[BlockIndex(state.grid, 0, state.cell[index])];
+    *std::find(cell.begin(), cell.end(), index) = cell.back();
+    cell.pop_back();
+    RefreshMaxVolume(state, state.cell[index]);
+}
+
+template <typename CostPolicy>
+TreeNode* BottomUpTree(NodeArena& arena, std::vector<TreeNode*>& nodes, int searchRadius) {
+    if (nodes.empty()) return nullptr;
+
+    AgglomerativeState state;
+    AABB centerBounds;
+    centerBounds.min = glm::vec3(std::numeric_limits<float>::max());
+    centerBounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const TreeNode* node : nodes) {
+        glm::vec3 center = (node->aabbVolume.min + node->aabbVolume.max) * 0.5f;
+        centerBounds.min = glm::min(centerBounds.min, center);
+        centerBounds.max = glm::max(centerBounds.max, center);
+    }
+
+    // Cubic cells, grown from tiny until the leaves fill them so flat scenes still get fine cells
+    CenterGrid& grid = state.grid;
+    glm::vec3 spread = centerBounds.max - centerBounds.min;
+    float maxSpread = std::max({ spread.x, spread.y, spread.z });
+    grid.origin = centerBounds.min;
+    grid.cellSize = maxSpread > 0.0f ? maxSpread / nodes.size() : 1.0f;
+    glm::ivec3 dims;
+    while (true) {
+        dims = glm::ivec3(spread / grid.cellSize) + 1;
+        if (dims == glm::ivec3(1) || static_cast<double>(dims.x) * dims.y * dims.z * BOTTOM_UP_LEAVES_PER_CELL <= nodes.size()) break;
+        grid.cellSize *= 1.25f;
+    }
+    grid.dims.push_back(dims);
+    while (dims != glm::ivec3(1)) {
+        dims = (dims + 1) / 2;
+        grid.dims.push_back(dims);
+    }
+    for (const glm::ivec3& levelDims : grid.dims) {
+        grid.maxVolume.emplace_back(static_cast<size_t>(levelDims.x) * levelDims.y * levelDims.z, -1.0f);
+    }
+    grid.cells.resize(grid.maxVolume[0].size());
+
+    state.nodes.reserve(2 * nodes.size() - 1);
+    state.alive.reserve(2 * nodes.size() - 1);
+    state.volume.reserve(2 * nodes.size() - 1);
+    state.cell.reserve(2 * nodes.size() - 1);
+    for (TreeNode* node : nodes) {
+        AddNode(state, node);
+    }
+
+    // Every alive node keeps at least one entry in the queue. An entry whose partner has since
+    // been merged is stale and is searched again when it surfaces; its old cost can only be lower
+    // than the fresh one, so no better merge is ever skipped.
+    std::priority_queue<MergeCandidate, std::vector<MergeCandidate>, std::greater<MergeCandidate>> queue;
+    int numAlive = static_cast<int>(nodes.size());
+    if (numAlive > 1) {
+        for (int i = 0; i < numAlive; ++i) {
+            queue.push(FindBestPartner<CostPolicy>(state, i, searchRadius));
+        }
+    }
+
+    while (numAlive > 1 && !BuildCancelled()) {
+        MergeCandidate candidate = queue.top();
+        queue.pop();
+        if (!state.alive[candidate.node]) continue;
+        if (!state.alive[candidate.partner]) {
+            queue.push(FindBestPartner<CostPolicy>(state, candidate.node, searchRadius));
+            continue;
+        }
+
+        RemoveNode(state, candidate.node);
+        RemoveNode(state, candidate.partner);
+        int parent = AddNode(state, arena.New(state.nodes[candidate.node], state.nodes[candidate.partner]));
+        if (--numAlive > 1) {
+            queue.push(FindBestPartner<CostPolicy>(state, parent, searchRadius));
+        }
+    }
+
+    // Only left over when cancelled: pair up the rest without searching so the tree is complete
+    std::vector<TreeNode*> remaining;
+    for (size_t i = 0; i < state.nodes.size(); ++i) {
+        if (state.alive[i]) remaining.push_back(state.nodes[i]);
+    }
+    while (remaining.size() > 1) {
+        TreeNode* second = remaining.back();
+        remaining.pop_back();
+        remaining.back() = arena.New(remaining.back(), second);
+    }
+
+    nodes.assign(1, remaining[0]);
+    return nodes[0]; // return the root node
+}
+
+template TreeNode* BottomUpTree<CombinedMergeCost>(NodeArena& arena, std::vector<TreeNode*>& nodes, int searchRadius);
+template TreeNode* BottomUpTree<SurfaceAreaMergeCost>(NodeArena& arena, std::vector<TreeNode*>& nodes, int searchRadius);
+template TreeNode* BottomUpTree<VolumeMergeCost>(NodeArena& arena, std::vector<TreeNode*>& nodes, int searchRadius);
+
+TreeNode* BottomUpTree(NodeArena& arena, std::vector<TreeNode*>& nodes, MergeCostType costType, int searchRadius) {
+    switch (costType) {
+    case MC_SURFACE_AREA:
+        return BottomUpTree<SurfaceAreaMergeCost>(arena, nodes, searchRadius);
+    case MC_VOLUME:
+        return BottomUpTree<VolumeMergeCost>(arena, nodes, searchRadius);
+    default:
+        return BottomUpTree<CombinedMergeCost>(arena, nodes, searchRadius);
+    }
+}
+
+AABB ComputeAABB(std::span<const Object> objects) {
+    AABB bv;
+    bv.min = glm::vec3(std::numeric_limits<float>::max());
+    bv.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (const auto& obj : objects) {
+        bv.min = glm::min(bv.min, obj.boundingBox.min);
+        bv.max = glm::max(bv.max, obj.boundingBox.max);
+    }
+
+    return bv;
+}
+
+AABB ComputeAABB(std::span<Object* const> objects) {
+    AABB bv;
+    bv.min = glm::vec3(std::numeric_limits<float>::max());
+    bv.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (const Object* obj : objects) {
+        bv.min = glm::min(bv.min, obj->boundingBox.min);
+        bv.max = glm::max(bv.max, obj->boundingBox.max);
+    }
+
+    return bv;
+}
+
+BoundingSphere ComputeBV(std::span<Object* const> objects, BoundingVolumeType bvType) {
+    switch (bvType) {
+    case BVT_RITTER_SPHERE:
+        return ComputeRitterSphere(objects);
+    case BVT_LARSSON_SPHERE:
+        return ComputeLarssonSphere(objects);
+    case BVT_PCA_SPHERE:
+        return ComputePCASphere(objects);
+    default:
+        throw std::runtime_error("Unknown Bounding Volume Type");
+    }
+}
+
+std::vector<TreeNode*> InitializeLeafNodes(NodeArena& arena, const std::vector<Object>& objects) {
+    std::vector<TreeNode*> nodes;
+    nodes.reserve(objects.size());
+    for (const auto& obj : objects) {
+        TreeNode* node = arena.New();
+        node->aabbVolume = obj.boundingBox;
+        node->ritterVolume = obj.ritterSphere;
+        node->larssonVolume = obj.larssonSphere;
+        node->pcaVolume = obj.pcaSphere;
+        node->objects = const_cast<Object*>(&obj); // Leaf nodes contain the actual objects
+        node->numObjects = 1;
+        nodes.push_back(node);
+    }
+    return nodes;
+}
+
+std::vector<Object*> ObjectPointers(const std::vector<Object>& objects) {
+    std::vector<Object*> pointers;
+    pointers.reserve(objects.size());
+    for (const auto& obj : objects) {
+        pointers.push_back(const_cast<Object*>(&obj));
+    }
+    return pointers;
+}
+
+int PartitionObjects(std::span<Object*> objects, int axis, SplitMethod splitMethod) {
+    int numObjects = objects.size();
+    if (numObjects <= 1) {
+        return 0;
+    }
+
+    if (splitMethod == SM_MEDIAN_CENTER) {
+        // Sort objects based on the center of their bounding volumes along the given axis
+        if (axis == 0) {
+            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
+                [](const Object* a, const Object* b) {
+                    return (a->boundingBox.min.x + a->boundingBox.max.x) < (b->boundingBox.min.x + b->boundingBox.max.x);
+                });
+        }
+        else if (axis == 1) {
+            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
+                [](const Object* a, const Object* b) {
+                    return (a->boundingBox.min.y + a->boundingBox.max.y) < (b->boundingBox.min.y + b->boundingBox.max.y);
+                });
+        }
+        else {
+            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
+                [](const Object* a, const Object* b) {
+                    return (a->boundingBox.min.z + a->boundingBox.max.z) < (b->boundingBox.min.z + b->boundingBox.max.z);
+                });
+        }
+        return numObjects / 2;
+    }
+    else if (splitMethod == SM_MEDIAN_EXTENT) {
+        // Sort objects based on the extents of their bounding volumes along the given axis
+        if (axis == 0) {
+            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
+                [](const Object* a, const Object* b) {
+                    return a->boundingBox.max.x < b->boundingBox.max.x;
+                });
+        }
+        else if (axis == 1) {
+            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
+                [](const Object* a, const Object* b) {
+                    return a->boundingBox.max.y < b->boundingBox.max.y;
+                });
+        }
+        else {
+            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
+                [](const Object* a, const Object* b) {
+                    return a->boundingBox.max.z < b->boundingBox.max.z;
+                });
+        }
+        return numObjects / 2;
+    }
+    else if (splitMethod == SM_SAH) {
+        // Bin object centers along the axis and pick the plane with the lowest surface area cost
+        const int NUM_BINS = 16;
+        float minC = std::numeric_limits<float>::max();
+        float maxC = std::numeric_limits<float>::lowest();
+        for (const Object* obj : objects) {
+            float c = obj->boundingBox.min[axis] + obj->boundingBox.max[axis];
+            minC = std::min(minC, c);
+            maxC = std::max(maxC, c);
+        }
+        if (maxC <= minC) {
+            return PartitionObjects(objects, axis, SM_MEDIAN_CENTER);
+        }
+
+        AABB binBounds[NUM_BINS];
+        int binCounts[NUM_BINS] = {};
+        for (auto& b : binBounds) {
+            b.min = glm::vec3(std::numeric_limits<float>::max());
+            b.max = glm::vec3(std::numeric_limits<float>::lowest());
+        }
+        float scale = NUM_BINS / (maxC - minC);
+        auto binOf = [&](const Object* obj) {
+            int bin = static_cast<int>((obj->boundingBox.min[axis] + obj->boundingBox.max[axis] - minC) * scale);
+            return std::min(bin, NUM_BINS - 1);
+        };
+        for (const Object* obj : objects) {
+            int bin = binOf(obj);
+            binCounts[bin]++;
+            binBounds[bin] = MergeAABB(binBounds[bin], obj->boundingBox);
+        }
+
+        // Sweep from the right to get the area of every suffix, then from the left to evaluate each plane
+        float rightArea[NUM_BINS];
+        int rightCount[NUM_BINS];
+        AABB acc = binBounds[NUM_BINS - 1];
+        int count = 0;
+        for (int i = NUM_BINS - 1; i > 0; --i) {
+            acc = MergeAABB(acc, binBounds[i]);
+            count += binCounts[i];
+            rightArea[i] = SurfaceArea(acc);
+            rightCount[i] = count;
+        }
+
+        float bestCost = std::numeric_limits<float>::max();
+        int bestBin = -1;
+        acc = binBounds[0];
+        count = 0;
+        for (int i = 0; i < NUM_BINS - 1; ++i) {
+            acc = MergeAABB(acc, binBounds[i]);
+            count += binCounts[i];
+            if (count == 0 || rightCount[i + 1] == 0) continue;
+            float cost = SurfaceArea(acc) * count + rightArea[i + 1] * rightCount[i + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestBin = i;
+            }
+        }
+        if (bestBin < 0) {
+            return PartitionObjects(objects, axis, SM_MEDIAN_CENTER);
+        }
+
+        auto mid = std::partition(objects.begin(), objects.end(), [&](const Object* obj) {
+            return binOf(obj) <= bestBin;
+            });
+        return static_cast<int>(mid - objects.begin());
+    }
+
+    return numObjects / 2; // Default split point
+}
+
+int PartitionObjectsK(std::span<Object*> objects, int axis, int k, int splitPoints[BVH_WIDTH + 1]) {
+    int numObjects = objects.size();
+    int numParts = std::clamp(k, 1, std::min(numObjects, BVH_WIDTH));
+
+    // Every part gets the same share of objects, ordered by center along the axis
+    auto centerLess = [axis](const Object* a, const Object* b) {
+        return (a->boundingBox.min[axis] + a->boundingBox.max[axis]) < (b->boundingBox.min[axis] + b->boundingBox.max[axis]);
+        };
+
+    splitPoints[0] = 0;
+    for (int i = 1; i < numParts; ++i) {
+        splitPoints[i] = i * numObjects / numParts;
+        std::nth_element(objects.begin() + splitPoints[i - 1], objects.begin() + splitPoints[i], objects.end(), centerLess);
+    }
+    splitPoints[numParts] = numObjects;
+
+    return numParts;
+}
+
+int ChooseSplitAxis(std::span<Object* const> objects, int depth, AxisMethod axisMethod) {
+    if (axisMethod == AM_LONGEST_EXTENT) {
+        // Split across the widest spread of object centers
+        glm::vec3 minC(std::numeric_limits<float>::max());
+        glm::vec3 maxC(std::numeric_limits<float>::lowest());
+        for (const Object* obj : objects) {
+            glm::vec3 c = obj->boundingBox.min + obj->boundingBox.max;
+            minC = glm::min(minC, c);
+            maxC = glm::max(maxC, c);
+        }
+        glm::vec3 extent = maxC - minC;
+        if (extent.x >= extent.y && extent.x >= extent.z) return 0;
+        return extent.y >= extent.z ? 1 : 2;
+    }
+    else if (axisMethod == AM_MAX_VARIANCE) {
+        // Split along the axis where object centers vary the most
+        glm::vec3 mean(0.0f);
+        for (const Object* obj : objects) {
+            mean += (obj->boundingBox.min + obj->boundingBox.max) * 0.5f;
+        }
+        mean /= static_cast<float>(objects.size());
+
+        glm::vec3 variance(0.0f);
+        for (const Object* obj : objects) {
+            glm::vec3 d = (obj->boundingBox.min + obj->boundingBox.max) * 0.5f - mean;
+            variance += d * d;
+        }
+        if (variance.x >= variance.y && variance.x >= variance.z) return 0;
+        return variance.y >= variance.z ? 1 : 2;
+    }
+
+    return depth % 3; // Alternate between x, y, and z axes
+}
+
+// Partition objects along the axis with the current split method, returning the number of parts
+static int SplitObjects(std::span<Object*> objects, int axis, int splitPoints[BVH_WIDTH + 1]) {
+    if (currentSplitMethod == SM_K_EVEN_SPLITS) {
+        return PartitionObjectsK(objects, axis, kSplits, splitPoints);
+    }
+
+    splitPoints[0] = 0;
+    splitPoints[1] = PartitionObjects(objects, axis, currentSplitMethod);
+    splitPoints[2] = objects.size();
+    return 2;
+}
+
+// Surface area cost of a partition: each part weighted by how many objects it holds
+static float PartitionCost(std::span<Object* const> objects, const int splitPoints[BVH_WIDTH + 1], int numParts) {
+    float cost = 0.0f;
+    for (int i = 0; i < numParts; ++i) {
+        std::span<Object* const> part = objects.subspan(splitPoints[i], splitPoints[i + 1] - splitPoints[i]);
+        cost += SurfaceArea(ComputeAABB(part)) * part.size();
+    }
+    return cost;
+}
+
+void TopDownTree(NodeArena& arena, TreeNode* node, std::span<Object*> objects, int depth, int maxheightV) {
+    if (BuildCancelled()) {
+        node->type = LEAF;
+        node->byReference = true;
+        node->objectRefs = objects.data();
+        node->numObjects = objects.size();
+        node->numChildren = 0;
+        return;
+    }
+
+    node->aabbVolume = ComputeAABB(objects);
+    node->ritterVolume = ComputeBV(objects, BVT_RITTER_SPHERE);
+    node->larssonVolume = ComputeBV(objects, BVT_LARSSON_SPHERE);
+    node->pcaVolume = ComputeBV(objects, BVT_PCA_SPHERE);
+    node->numObjects = objects.size();
+
+    if (objects.size() <= MIN_OBJECTS_AT_LEAF || (depth >= maxheightV && maxHeight)) {
+        node->type = LEAF;
+        node->byReference = true;
+        node->objectRefs = objects.data();
+        node->numChildren = 0;
+    }
+    else {
+        node->type = INTERNAL;
+        node->objects = nullptr;
+
+        int splitPoints[BVH_WIDTH + 1];
+        int numParts;
+        if (currentAxisMethod == AM_BEST_COST) {
+            // Try every axis and keep the partition with the lowest surface area cost
+            int bestAxis = 0;
+            float bestCost = std::numeric_limits<float>::max();
+            for (int axis = 0; axis < 3; ++axis) {
+                numParts = SplitObjects(objects, axis, splitPoints);
+                float cost = PartitionCost(objects, splitPoints, numParts);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                }
+            }
+            numParts = SplitObjects(objects, bestAxis, splitPoints);
+        }
+        else {
+            numParts = SplitObjects(objects, ChooseSplitAxis(objects, depth, currentAxisMethod), splitPoints);
+        }
+
+        // Children partition the parent's range of pointers in place
+        node->numChildren = numParts;
+        for (int i = 0; i < numParts; ++i) {
+            node->children[i] = arena.New();
+            TopDownTree(arena, node->children[i], objects.subspan(splitPoints[i], splitPoints[i + 1] - splitPoints[i]), depth + 1, maxheightV);
+        }
+        node->UpdateChildBounds();
+    }
+}
+
+void CollapseToWide(TreeNode* node, int width) {
+    if (!node || node->type == LEAF) return;
+
+    // Open the largest internal child whose children still fit, until the node is full
+    while (node->numChildren < width) {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int i = 0; i < node->numChildren; ++i) {
+            TreeNode* child = node->children[i];
+            if (child->type == INTERNAL && node->numChildren - 1 + child->numChildren <= width) {
+                float area = SurfaceArea(child->aabbVolume);
+                if (area > bestArea) {
+                    bestArea = area;
+                    best = i;
+                }
+            }
+        }
+        if (best < 0) break;
+
+        TreeNode* opened = node->children[best];
+        node->children[best] = opened->children[0];
+        for (int i = 1; i < opened->numChildren; ++i) {
+            node->children[node->numChildren++] = opened->children[i];
+        }
+    }
+    node->UpdateChildBounds();
+
+    for (int i = 0; i < node->numChildren; ++i) {
+        CollapseToWide(node->children[i], width);
+    }
+}
+
+AABB ComputeAABB(const objl::Mesh& mesh) {
+    AABB aabb;
+    aabb.min = glm::vec3(std::numeric_limits<float>::max());
+    aabb.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (const auto& vertex : mesh.Vertices) {
+        aabb.min = glm::min(aabb.min, glm::vec3(vertex.Position.X, vertex.Position.Y, vertex.Position.Z));
+        aabb.max = glm::max(aabb.max, glm::vec3(vertex.Position.X, vertex.Position.Y, vertex.Position.Z));
+    }
+
+    return aabb;
+}
+
+std::vector<Triangle> MeshTriangles(const objl::Mesh& mesh) {
+    std::vector<Triangle> triangles;
+    triangles.reserve(mesh.Indices.size() / 3);
+
+    auto position = [&](unsigned int index) {
+        const auto& p = mesh.Vertices[index].Position;
+        return glm::vec3(p.X, p.Y, p.Z);
+        };
+    for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+        triangles.push_back({ position(mesh.Indices[i]), position(mesh.Indices[i + 1]), position(mesh.Indices[i + 2]) });
+    }
+
+    return triangles;
+}
+
+AABB TriangleAABB(const Triangle& tri) {
+    AABB aabb;
+    aabb.min = glm::min(tri.v1, glm::min(tri.v2, tri.v3));
+    aabb.max = glm::max(tri.v1, glm::max(tri.v2, tri.v3));
+    return aabb;
+}
+
+AABB IntersectAABB(const AABB& a, const AABB& b) {
+    AABB result;
+    result.min = glm::max(a.min, b.min);
+    result.max = glm::min(a.max, b.max);
+    return result;
+}
+
+bool AABBOverlap(const AABB& a, const AABB& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+        a.min.y <= b.max.y && a.max.y >= b.min.y &&
+        a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool SphereAABBOverlap(const BoundingSphere& sphere, const AABB& box) {
+    glm::vec3 offset = glm::max(box.min - sphere.center, 0.0f) + glm::max(sphere.center - box.max, 0.0f);
+    return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
+
+Frustum ExtractFrustum(const glm::mat4& viewProjection) {
+    // Gribb-Hartmann: each plane is the last row of the matrix plus or minus another row
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    Frustum frustum;
+    for (int i = 0; i < 3; ++i) {
+        frustum.planes[2 * i].normal = rows[3] + rows[i];
+        frustum.planes[2 * i + 1].normal = rows[3] - rows[i];
+    }
+    for (Plane& plane : frustum.planes) {
+        plane.normal /= glm::length(glm::vec3(plane.normal));
+    }
+    return frustum;
+}
+
+bool AABBInFrustum(const Frustum& frustum, const AABB& box) {
+    for (const Plane& plane : frustum.planes) {
+        // The corner farthest along the plane normal
+        glm::vec3 corner(plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+            plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+            plane.normal.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane.normal), corner) + plane.normal.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FrustumClass ClassifyAABB(const Frustum& frustum, const AABB& box) {
+    FrustumClass result = FC_INSIDE;
+    for (const Plane& plane : frustum.planes) {
+        // The corners farthest along and against the plane normal
+        glm::vec3 farCorner(plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+            plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+            plane.normal.z >= 0.0f ? box.max.z : box.min.z);
+        glm::vec3 nearCorner(plane.normal.x >= 0.0f ? box.min.x : box.max.x,
+            plane.normal.y >= 0.0f ? box.min.y : box.max.y,
+            plane.normal.z >= 0.0f ? box.min.z : box.max.z);
+        if (glm::dot(glm::vec3(plane.normal), farCorner) + plane.normal.w < 0.0f) {
+            return FC_OUTSIDE;
+        }
+        if (glm::dot(glm::vec3(plane.normal), nearCorner) + plane.normal.w < 0.0f) {
+            result = FC_INTERSECTS;
+        }
+    }
+    return result;
+}
+
+bool RayIntersectsAABB(const Ray& ray, const glm::vec3& invDir, const AABB& box, float tMax, float& tEntry) {
+    // Slab test: intersect the ray's parameter interval with each axis' slab
+    glm::vec3 t0 = (box.min - ray.start) * invDir;
+    glm::vec3 t1 = (box.max - ray.start) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+
+    tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    return tEntry <= tExit;
+}
+
+bool RayIntersectsSphere(const Ray& ray, const BoundingSphere& sphere, float tMax, float& tEntry) {
+    // Roots of |start + t * direction - center|^2 = radius^2
+    glm::vec3 offset = ray.start - sphere.center;
+    float a = glm::dot(ray.direction, ray.direction);
+    float b = glm::dot(ray.direction, offset);
+    float c = glm::dot(offset, offset) - sphere.radius * sphere.radius;
+    if (c <= 0.0f) {
+        tEntry = 0.0f;
+        return true;
+    }
+
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f || b >= 0.0f) return false; // Missed, or starting outside and heading away
+
+    tEntry = (-b - std::sqrt(discriminant)) / a;
+    return tEntry <= tMax;
+}
+
+bool IntersectRayTriangle(const Ray& ray, const Triangle& tri, float tMax, float& t, float& u, float& v) {
+    // Moller-Trumbore
+    const float EPSILON = 1e-12f;
+    glm::vec3 edge1 = tri.v2 - tri.v1;
+    glm::vec3 edge2 = tri.v3 - tri.v1;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::abs(det) < EPSILON) return false; // Ray parallel to the triangle
+
+    float invDet = 1.0f / det;
+    glm::vec3 s = ray.start - tri.v1;
+    u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    t = glm::dot(edge2, q) * invDet;
+    return t >= 0.0f && t <= tMax;
+}
+
+bool TriangleAABBOverlap(const Triangle& tri, const AABB& box) {
+    // Separating axis test: box faces, triangle normal and the nine edge cross products
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extents = (box.max - box.min) * 0.5f;
+    glm::vec3 v0 = tri.v1 - center;
+    glm::vec3 v1 = tri.v2 - center;
+    glm::vec3 v2 = tri.v3 - center;
+    const glm::vec3 edges[3] = { v1 - v0, v2 - v1, v0 - v2 };
+
+    for (int i = 0; i < 3; ++i) {
+        glm::vec3 boxAxis(0.0f);
+        boxAxis[i] = 1.0f;
+        for (const auto& edge : edges) {
+            glm::vec3 axis = glm::cross(boxAxis, edge);
+            float p0 = glm::dot(v0, axis);
+            float p1 = glm::dot(v1, axis);
+            float p2 = glm::dot(v2, axis);
+            float r = glm::dot(extents, glm::abs(axis));
+            if (std::max(-std::max(std::max(p0, p1), p2), std::min(std::min(p0, p1), p2)) > r) return false;
+        }
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        if (std::max(std::max(v0[i], v1[i]), v2[i]) < -extents[i] || std::min(std::min(v0[i], v1[i]), v2[i]) > extents[i]) return false;
+    }
+
+    glm::vec3 normal = glm::cross(edges[0], edges[1]);
+    return std::abs(glm::dot(normal, v0)) <= glm::dot(extents, glm::abs(normal));
+}
+
+// Ritter's second pass: an initial sphere fit to a few extreme points, grown over each point
+// still outside until it encloses them all
+static void GrowToEnclose(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius) {
+    for (const auto& p : points) {
+        float dist = glm::distance(center, p);
+        if (dist > radius) {
+            float newRadius = (radius + dist) * 0.5f;
+            float k = (newRadius - radius) / dist;
+            radius = newRadius;
+            center += k * (p - center);
+        }
+    }
+}
+
+BoundingSphere ComputeRitterSphere(std::span<Object* const> objects) {
+    std::vector<glm::vec3> points;
+    for (const Object* obj : objects) {
+        for (const auto& vertex : obj->mesh.Vertices) {
+            points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
+        }
+    }
+
+    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
+
+    glm::vec3 x = points[0];
+    glm::vec3 y = points[0];
+    float maxDistSq = 0;
+
+    for (const auto& p : points) {
+        float distSq = glm::distance2(p, x);
+        if (distSq > maxDistSq) {
+            y = p;
+            maxDistSq = distSq;
+        }
+    }
+
+    glm::vec3 z = y;
+    maxDistSq = 0;
+    for (const auto& p : points) {
+        float distSq = glm::distance2(p, y);
+        if (distSq > maxDistSq) {
+            z = p;
+            maxDistSq = distSq;
+        }
+    }
+
+    glm::vec3 center = (y + z) * 0.5f;
+    float radius = glm::distance(y, z) * 0.5f;
+
+    GrowToEnclose(points, center, radius);
+
+    return { center, radius };
+}
+
+BoundingSphere ComputeLarssonSphere(std::span<Object* const> objects) {
+    std::vector<glm::vec3> points;
+    for (const Object* obj : objects) {
+        for (const auto& vertex : obj->mesh.Vertices) {
+            points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
+        }
+    }
+
+    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
+
+    glm::vec3 minPoint = points[0];
+    glm::vec3 maxPoint = points[0];
+
+    for (const auto& point : points) {
+        minPoint = glm::min(minPoint, point);
+        maxPoint = glm::max(maxPoint, point);
+    }
+
+    glm::vec3 center = (minPoint + maxPoint) * 0.5f;
+    float radius = 0.0f;
+
+    for (const auto& point : points) {
+        float dist = glm::distance(center, point);
+        if (dist > radius) {
+            radius = dist;
+        }
+    }
+
+    GrowToEnclose(points, center, radius);
+
+    return { center, radius };
+}
+
+BoundingSphere ComputePCASphere(std::span<Object* const> objects) {
+    std::vector<glm::vec3> points;
+    for (const Object* obj : objects) {
+        for (const auto& vertex : obj->mesh.Vertices) {
+            points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
+        }
+    }
+
+    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
+
+    glm::vec3 mean(0.0f);
+    for (const auto& p : points) {
+        mean += p;
+    }
+    mean /= static_cast<float>(points.size());
+
+    glm::mat3 covariance(0.0f);
+    for (const auto& p : points) {
+        glm::vec3 centered = p - mean;
+        covariance[0][0] += centered.x * centered.x;
+        covariance[0][1] += centered.x * centered.y;
+        covariance[0][2] += centered.x * centered.z;
+        covariance[1][0] += centered.y * centered.x;
+        covariance[1][1] += centered.y * centered.y;
+        covariance[1][2] += centered.y * centered.z;
+        covariance[2][0] += centered.z * centered.x;
+        covariance[2][1] += centered.z * centered.y;
+        covariance[2][2] += centered.z * centered.z;
+    }
+    covariance /= static_cast<float>(points.size());
+
+    glm::vec3 eigenvalues;
+    glm::mat3 eigenvectors;
+    glm::vec3 v(1.0f, 1.0f, 1.0f);
+    for (int i = 0; i < 10; ++i) {
+        v = covariance * v;
+        v = glm::normalize(v);
+    }
+    glm::vec3 principalComponent = v;
+
+    float minProj = std::numeric_limits<float>::max();
+    float maxProj = std::numeric_limits<float>::lowest();
+    for (const auto& p : points) {
+        float proj = glm::dot(p - mean, principalComponent);
+        minProj = std::min(minProj, proj);
+        maxProj = std::max(maxProj, proj);
+    }
+
+    glm::vec3 center = mean + principalComponent * (minProj + maxProj) * 0.5f;
+    float radius = (maxProj - minProj) * 0.5f;
+    GrowToEnclose(points, center, radius);
+
+    return { center, radius };
+}
+
+BoundingSphere ComputeRitterSphere(const objl::Mesh& mesh) {
+    std::vector<glm::vec3> points;
+    for (const auto& vertex : mesh.Vertices) {
+        points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
+    }
+
+    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
+
+    glm::vec3 x = points[0];
+    glm::vec3 y = points[0];
+    float maxDistSq = 0;
+
+    for (const auto& p : points) {
+        float distSq = glm::distance2(p, x);
+        if (distSq > maxDistSq) {
+            y = p;
+            maxDistSq = distSq;
+        }
+    }
+
+    glm::vec3 z = y;
+    maxDistSq = 0;
+    for (const auto& p : points) {
+        float distSq = glm::distance2(p, y);
+        if (distSq > maxDistSq) {
+            z = p;
+            maxDistSq = distSq;
+        }
+    }
+
+    glm::vec3 center = (y + z) * 0.5f;
+    float radius = glm::distance(y, z) * 0.5f;
+
+    GrowToEnclose(points, center, radius);
+
+    return { center, radius };
+}
+
+BoundingSphere ComputeLarssonSphere(const objl::Mesh& mesh) {
+    std::vector<glm::vec3> points;
+    for (const auto& vertex : mesh.Vertices) {
+        points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
+    }
+
+    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
+
+    glm::vec3 minPoint = points[0];
+    glm::vec3 maxPoint = points[0];
+
+    for (const auto& point : points) {
+        minPoint = glm::min(minPoint, point);
+        maxPoint = glm::max(maxPoint, point);
+    }
+
+    glm::vec3 center = (minPoint + maxPoint) * 0.5f;
+    float radius = 0.0f;
+
+    for (const auto& point : points) {
+        float dist = glm::distance(center, point);
+        if (dist > radius) {
+            radius = dist;
+        }
+    }
+
+    GrowToEnclose(points, center, radius);
+
+    return { center, radius };
+}
+
+BoundingSphere ComputePCASphere(const objl::Mesh& mesh) {
+    std::vector<glm::vec3> points;
+    for (const auto& vertex : mesh.Vertices) {
+        points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
+    }
+
+    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
+
+    glm::vec3 mean(0.0f);
+    for (const auto& p : points) {
+        mean += p;
+    }
+    mean /= static_cast<float>(points.size());
+
+    glm::mat3 covariance(0.0f);
+    for (const auto& p : points) {
+        glm::vec3 centered = p - mean;
+        covariance[0][0] += centered.x * centered.x;
+        covariance[0][1] += centered.x * centered.y;
+        covariance[0][2] += centered.x * centered.z;
+        covariance[1][0] += centered.y * centered.x;
+        covariance[1][1] += centered.y * centered.y;
+        covariance[1][2] += centered.y * centered.z;
+        covariance[2][0] += centered.z * centered.x;
+        covariance[2][1] += centered.z * centered.y;
+        covariance[2][2] += centered.z * centered.z;
+    }
+    covariance /= static_cast<float>(points.size());
+
+    glm::vec3 eigenvalues;
+    glm::mat3 eigenvectors;
+    glm::vec3 v(1.0f, 1.0f, 1.0f);
+    for (int i = 0; i < 10; ++i) {
+        v = covariance * v;
+        v = glm::normalize(v);
+    }
+    glm::vec3 principalComponent = v;
+
+    float minProj = std::numeric_limits<float>::max();
+    float maxProj = std::numeric_limits<float>::lowest();
+    for (const auto& p : points) {
+        float proj = glm::dot(p - mean, principalComponent);
+        minProj = std::min(minProj, proj);
+        maxProj = std::max(maxProj, proj);
+    }
+
+    glm::vec3 center = mean + principalComponent * (minProj + maxProj) * 0.5f;
+    float radius = (maxProj - minProj) * 0.5f;
+    GrowToEnclose(points, center, radius);
+
+    return { center, radius };
+}
+
+int TreeDepth(TreeNode* node) {
+    if (!node) {
+        return 0;
+    }
+
+    int childDepth = 0;
+    for (int i = 0; i < node->numChildren; ++i) {
+        childDepth = std::max(childDepth, TreeDepth(node->children[i]));
+    }
+
+    return childDepth + 1;
+}
+
+int CountNodes(TreeNode* node) {
+    if (!node) {
+        return 0;
+    }
+
+    int count = 1;
+    for (int i = 0; i < node->numChildren; ++i) {
+        count += CountNodes(node->children[i]);
+    }
+    return count;
+}
+
+float TotalNodeVolume(TreeNode* node) {
+    if (!node) {
+        return 0.0f;
+    }
+
+    float volume = Volume(node->aabbVolume);
+    for (int i = 0; i < node->numChildren; ++i) {
+        volume += TotalNodeVolume(node->children[i]);
+    }
+    return volume;
+}
+
+// Sum of surface-area-weighted costs, before dividing by the root's area
+static float SAHCostSum(TreeNode* node) {
+    float area = SurfaceArea(node->aabbVolume);
+    if (node->type == LEAF) {
+        return area * node->numObjects * SAH_INTERSECTION_COST;
+    }
+
+    float cost = area * SAH_TRAVERSAL_COST;
+    for (int i = 0; i < node->numChildren; ++i) {
+        cost += SAHCostSum(node->children[i]);
+    }
+    return cost;
+}
+
+float TreeSAHCost(TreeNode* root) {
+    if (!root) {
+        return 0.0f;
+    }
+
+    float rootArea = SurfaceArea(root->aabbVolume);
+    return rootArea > 0.0f ? SAHCostSum(root) / rootArea : 0.0f;
+}
+
+static int RayNodeVisits(TreeNode* node, const Ray& ray, const glm::vec3& invDir, float tMax) {
+    int visits = 1;
+    float tEntry;
+    if (!RayIntersectsAABB(ray, invDir, node->aabbVolume, tMax, tEntry)) {
+        return visits;
+    }
+
+    for (int i = 0; i < node->numChildren; ++i) {
+        visits += RayNodeVisits(node->children[i], ray, invDir, tMax);
+    }
+    return visits;
+}
+
+int RayNodeVisits(TreeNode* root, const Ray& ray, float tMax) {
+    return root ? RayNodeVisits(root, ray, 1.0f / ray.direction, tMax) : 0;
+}
+
+int OverlapNodeVisits(TreeNode* node, const AABB& box) {
+    if (!node) return 0;
+
+    int visits = 1;
+    if (!AABBOverlap(node->aabbVolume, box)) {
+        return visits;
+    }
+
+    for (int i = 0; i < node->numChildren; ++i) {
+        visits += OverlapNodeVisits(node->children[i], box);
+    }
+    return visits;
+}
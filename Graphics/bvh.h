@@ -0,0 +1,245 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <memory>
+#include <atomic>
+#include "classes.h"
+#include "OBJ_Loader.h"
+
+#define MIN_OBJECTS_AT_LEAF 1
+
+// Relative costs of visiting a node and testing an object, used by the surface area heuristic
+#define SAH_TRAVERSAL_COST 1.0f
+#define SAH_INTERSECTION_COST 1.0f
+
+// Maximum number of children per node, chosen at compile time (2, 4 or 8)
+#define BVH_WIDTH 4
+static_assert(BVH_WIDTH == 2 || BVH_WIDTH == 4 || BVH_WIDTH == 8, "BVH_WIDTH must be 2, 4 or 8");
+
+// Grid cells on each side the bottom-up builder searches for a partner; 0 searches until exact
+#define BOTTOM_UP_SEARCH_RADIUS 0
+
+struct BLAS;
+class NodeArena;
+
+struct Object {
+    AABB boundingBox;
+    BoundingSphere ritterSphere;
+    BoundingSphere larssonSphere;
+    BoundingSphere pcaSphere;
+    objl::Mesh mesh; // Store the mesh for access to vertices
+    std::shared_ptr<const BLAS> blas; // Triangle BVH built at load time, shared by copies of the object
+};
+
+enum NodeType { INTERNAL, LEAF };
+
+AABB MergeAABB(const AABB& a, const AABB& b);
+BoundingSphere MergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b);
+
+// Nodes start on a cache line; trees allocate them from a NodeArena
+struct alignas(64) TreeNode {
+    NodeType type;
+    AABB aabbVolume;
+    BoundingSphere ritterVolume;
+    BoundingSphere larssonVolume;
+    BoundingSphere pcaVolume;
+
+    bool byReference; // Leaf reads its objects through objectRefs rather than objects; sits in padding
+    union {
+        Object* objects;           // pointer to objects/BVs that the node represents
+        Object* const* objectRefs; // Top-down leaves: pointers to the objects, which lie anywhere in the scene
+    };
+    int numObjects; // How many objects in this subtree?
+    int numChildren;
+    TreeNode* children[BVH_WIDTH];
+
+    // Children's AABBs in SoA layout so every child can be tested in one pass.
+    // Unused slots hold an inverted box that never overlaps anything.
+    alignas(32) float childMinX[BVH_WIDTH];
+    alignas(32) float childMinY[BVH_WIDTH];
+    alignas(32) float childMinZ[BVH_WIDTH];
+    alignas(32) float childMaxX[BVH_WIDTH];
+    alignas(32) float childMaxY[BVH_WIDTH];
+    alignas(32) float childMaxZ[BVH_WIDTH];
+
+    // Constructor for leaf nodes
+    TreeNode() : type(LEAF), byReference(false), objects(nullptr), numObjects(0), numChildren(0), children{} {
+        UpdateChildBounds();
+    }
+
+    // Constructor for internal nodes
+    TreeNode(TreeNode* left, TreeNode* right) : type(INTERNAL), byReference(false), objects(nullptr), numChildren(2), children{ left, right } {
+        numObjects = left->numObjects + right->numObjects;
+
+        // Merge the volumes of left and right children
+        aabbVolume = MergeAABB(left->aabbVolume, right->aabbVolume);
+        ritterVolume = MergeBoundingSpheres(left->ritterVolume, right->ritterVolume);
+        larssonVolume = MergeBoundingSpheres(left->larssonVolume, right->larssonVolume);
+        pcaVolume = MergeBoundingSpheres(left->pcaVolume, right->pcaVolume);
+        UpdateChildBounds();
+    }
+
+    // Refresh the SoA child bounds after children are added or replaced
+    void UpdateChildBounds();
+
+    // The i-th object of a leaf
+    Object& LeafObject(int i) const { return byReference ? *objectRefs[i] : objects[i]; }
+};
+
+enum ConstructionMethod {
+    CM_TOP_DOWN,
+    CM_BOTTOM_UP,
+    CM_LBVH,
+    CM_PLOC,
+    CM_AAC,
+    CM_INSERTION
+};
+
+// Add this enumeration to your global scope
+enum BoundingVolumeType {
+    BVT_NONE,
+    BVT_AABB,
+    BVT_RITTER_SPHERE,
+    BVT_LARSSON_SPHERE,
+    BVT_PCA_SPHERE
+};
+
+// Where a box lies relative to a frustum
+enum FrustumClass {
+    FC_OUTSIDE,    // Wholly outside at least one plane
+    FC_INTERSECTS, // Straddles a plane; may still miss the frustum near its corners
+    FC_INSIDE      // Wholly inside every plane
+};
+
+struct BoundingVolumeCost {
+    float distance;
+    float combinedVolume;
+    float relativeVolumeIncrease;
+};
+
+enum SplitMethod {
+    SM_MEDIAN_CENTER,
+    SM_MEDIAN_EXTENT,
+    SM_K_EVEN_SPLITS,
+    SM_SAH
+};
+
+// How the top-down builder picks the axis to split along
+enum AxisMethod {
+    AM_ROUND_ROBIN,
+    AM_LONGEST_EXTENT,
+    AM_MAX_VARIANCE,
+    AM_BEST_COST
+};
+
+// Top-down builder settings. Thread-local so a background build keeps its own
+// settings while the UI thread changes them.
+extern thread_local SplitMethod currentSplitMethod;
+extern thread_local AxisMethod currentAxisMethod;
+extern thread_local int kSplits;
+extern thread_local bool maxHeight;
+
+// Set by the owner of a build running on this thread to abandon it. The builders
+// then finish quickly with a tree that is only fit for deleting.
+extern thread_local const std::atomic<bool>* buildCancelFlag;
+inline bool BuildCancelled() {
+    return buildCancelFlag && buildCancelFlag->load(std::memory_order_relaxed);
+}
+
+float Volume(const AABB& aabb);
+float SurfaceArea(const AABB& aabb);
+
+AABB ComputeAABB(std::span<const Object> objects);
+AABB ComputeAABB(std::span<Object* const> objects);
+AABB ComputeAABB(const objl::Mesh& mesh);
+BoundingSphere ComputeBV(std::span<Object* const> objects, BoundingVolumeType bvType);
+BoundingSphere ComputeRitterSphere(std::span<Object* const> objects);
+BoundingSphere ComputeLarssonSphere(std::span<Object* const> objects);
+BoundingSphere ComputePCASphere(std::span<Object* const> objects);
+BoundingSphere ComputeRitterSphere(const objl::Mesh& mesh);
+BoundingSphere ComputeLarssonSphere(const objl::Mesh& mesh);
+BoundingSphere ComputePCASphere(const objl::Mesh& mesh);
+
+std::vector<Triangle> MeshTriangles(const objl::Mesh& mesh);
+AABB TriangleAABB(const Triangle& tri);
+AABB IntersectAABB(const AABB& a, const AABB& b);
+bool AABBOverlap(const AABB& a, const AABB& b);
+// Slab test against a ray with precomputed 1 / direction; tEntry is clamped to the ray start
+bool RayIntersectsAABB(const Ray& ray, const glm::vec3& invDir, const AABB& box, float tMax, float& tEntry);
+// Same for a sphere; rays starting inside enter at 0
+bool RayIntersectsSphere(const Ray& ray, const BoundingSphere& sphere, float tMax, float& tEntry);
+// t is the hit distance along the ray, u and v the barycentrics of v2 and v3
+bool IntersectRayTriangle(const Ray& ray, const Triangle& tri, float tMax, float& t, float& u, float& v);
+bool TriangleAABBOverlap(const Triangle& tri, const AABB& box);
+bool SphereAABBOverlap(const BoundingSphere& sphere, const AABB& box);
+// Planes of an OpenGL projection * view matrix, facing inwards
+Frustum ExtractFrustum(const glm::mat4& viewProjection);
+// False only when the box lies wholly outside one plane, so boxes near the corners may pass
+bool AABBInFrustum(const Frustum& frustum, const AABB& box);
+FrustumClass ClassifyAABB(const Frustum& frustum, const AABB& box);
+
+BoundingVolumeCost CalculateBoundingVolumeCost(const TreeNode* a, const TreeNode* b);
+// distance + combined volume + relative volume increase, the bottom-up builder's merge heuristic
+float MergeCost(const TreeNode* a, const TreeNode* b);
+
+// Merge cost policies for the bottom-up builder, picked at compile time so the partner search
+// calls the cost directly. LowerBound is the least Cost any partner can have whose center is
+// at least gap from the center of a box of the given size on every axis, and whose volume is
+// at most maxVolume.
+struct CombinedMergeCost {
+    static float Cost(const TreeNode* a, const TreeNode* b) { return MergeCost(a, b); }
+    static float LowerBound(const glm::vec3& size, const glm::vec3& gap, float maxVolume);
+};
+
+// Surface area of the merged AABB, the quantity the surface area heuristic charges for
+struct SurfaceAreaMergeCost {
+    static float Cost(const TreeNode* a, const TreeNode* b) { return SurfaceArea(MergeAABB(a->aabbVolume, b->aabbVolume)); }
+    static float LowerBound(const glm::vec3& size, const glm::vec3& gap, float maxVolume);
+};
+
+// Volume of the merged AABB
+struct VolumeMergeCost {
+    static float Cost(const TreeNode* a, const TreeNode* b) { return Volume(MergeAABB(a->aabbVolume, b->aabbVolume)); }
+    static float LowerBound(const glm::vec3& size, const glm::vec3& gap, float maxVolume);
+};
+
+enum MergeCostType {
+    MC_COMBINED,
+    MC_SURFACE_AREA,
+    MC_VOLUME
+};
+
+// Greedy agglomerative clustering: repeatedly merges the pair with the lowest cost.
+// A priority queue holds each node's cached best partner, revalidated lazily once that
+// partner is merged away. Partners are searched best-first in a uniform grid over node
+// centers that is updated as nodes merge. The search is exact unless searchRadius limits
+// it to that many cells around the node.
+template <typename CostPolicy = CombinedMergeCost>
+TreeNode* BottomUpTree(NodeArena& arena, std::vector<TreeNode*>& nodes, int searchRadius = BOTTOM_UP_SEARCH_RADIUS);
+// Same, with the cost picked at run time once per build
+TreeNode* BottomUpTree(NodeArena& arena, std::vector<TreeNode*>& nodes, MergeCostType costType, int searchRadius = BOTTOM_UP_SEARCH_RADIUS);
+std::vector<TreeNode*> InitializeLeafNodes(NodeArena& arena, const std::vector<Object>& objects);
+// A pointer to each object, the array the top-down builder partitions
+std::vector<Object*> ObjectPointers(const std::vector<Object>& objects);
+
+int PartitionObjects(std::span<Object*> objects, int axis, SplitMethod splitMethod);
+int PartitionObjectsK(std::span<Object*> objects, int axis, int k, int splitPoints[BVH_WIDTH + 1]);
+int ChooseSplitAxis(std::span<Object* const> objects, int depth, AxisMethod axisMethod);
+// Splits objects recursively below node, reordering the pointers in place. Leaves reference the
+// objects through the pointer array, so both it and the objects must outlive the tree.
+void TopDownTree(NodeArena& arena, TreeNode* node, std::span<Object*> objects, int depth, int maxheightV);
+
+// Pull grandchildren up into their parent until nodes hold up to width children.
+// Opened nodes are left unused in the tree's arena.
+void CollapseToWide(TreeNode* node, int width = BVH_WIDTH);
+
+int TreeDepth(TreeNode* node);
+int CountNodes(TreeNode* node);
+float TotalNodeVolume(TreeNode* node);
+// Expected cost of a random query, normalised by the root's surface area
+float TreeSAHCost(TreeNode* root);
+
+// Nodes whose bounds a full (no early-out) ray or box query would test
+int RayNodeVisits(TreeNode* root, const Ray& ray, float tMax);
+int OverlapNodeVisits(TreeNode* node, const AABB& box);
@@ -0,0 +1,142 @@
+#include "bvhcache.h"
+#include "lbvh.h"
+#include "trbvh.h"
+#include <functional>
+
+size_t BVHConfigHash::operator()(const BVHConfig& config) const {
+    size_t hash = 0;
+    auto combine = [&hash](size_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        };
+    combine(config.method);
+    combine(config.splitMethod);
+    combine(config.axisMethod);
+    combine(config.kSplits);
+    combine(std::hash<int>()(config.heightCap));
+    combine(config.collapseWide);
+    combine(config.bottomUpRadius);
+    combine(config.bottomUpCost);
+    combine(config.mortonBits);
+    combine(config.plocRadius);
+    combine(config.plocDistance);
+    combine(config.aacMode);
+    combine(config.optimizeTreelets);
+    return hash;
+}
+
+TreeNode* BuildBVH(NodeArena& arena, const BVHConfig& config, const std::vector<Object>& objects, std::vector<Object*>& objectRefs) {
+    if (objects.empty()) return nullptr;
+
+    TreeNode* root = nullptr;
+    switch (config.method) {
+    case CM_TOP_DOWN: {
+        // The top-down builder reads its settings from the globals
+        SplitMethod savedSplitMethod = currentSplitMethod;
+        AxisMethod savedAxisMethod = currentAxisMethod;
+        int savedKSplits = kSplits;
+        bool savedMaxHeight = maxHeight;
+        currentSplitMethod = config.splitMethod;
+        currentAxisMethod = config.axisMethod;
+        kSplits = config.kSplits;
+        maxHeight = config.heightCap != INT_MAX;
+
+        objectRefs = ObjectPointers(objects);
+        root = arena.New();
+        TopDownTree(arena, root, objectRefs, 0, config.heightCap);
+
+        currentSplitMethod = savedSplitMethod;
+        currentAxisMethod = savedAxisMethod;
+        kSplits = savedKSplits;
+        maxHeight = savedMaxHeight;
+        break;
+    }
+    case CM_BOTTOM_UP: {
+        std::vector<TreeNode*> leafNodes = InitializeLeafNodes(arena, objects);
+        root = BottomUpTree(arena, leafNodes, config.bottomUpCost, config.bottomUpRadius);
+        break;
+    }
+    case CM_LBVH:
+        root = LBVHTree(arena, objects, config.mortonBits);
+        break;
+    case CM_PLOC:
+        root = PLOCTree(arena, objects, config.plocRadius, config.plocDistance);
+        break;
+    case CM_AAC:
+        root = AACTree(arena, objects, config.aacMode);
+        break;
+    case CM_INSERTION:
+        root = InsertionTree(arena, objects);
+        break;
+    }
+
+    if (config.optimizeTreelets) {
+        OptimizeTreelets(root);
+    }
+    if (config.collapseWide && !BuildCancelled()) {
+        CollapseToWide(root); // A cancelled tree may be one long chain
+    }
+    return root;
+}
+
+CachedBVH BuildCachedBVH(const BVHConfig& config, const std::vector<Object>& objects) {
+    CachedBVH bvh;
+    bvh.root = BuildBVH(bvh.arena, config, objects, bvh.objectRefs);
+    if (!BuildCancelled()) {
+        bvh.flat = FlattenBVH(bvh.root, objects);
+    }
+    return bvh;
+}
+
+const CachedBVH* BVHCache::Find(const BVHConfig& config) {
+    auto it = index.find(config);
+    if (it == index.end()) return nullptr;
+
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+}
+
+const CachedBVH* BVHCache::Get(const BVHConfig& config, const std::vector<Object>& objects) {
+    if (const CachedBVH* cached = Find(config)) {
+        return cached;
+    }
+    return Insert(config, BuildCachedBVH(config, objects));
+}
+
+const CachedBVH* BVHCache::Insert(const BVHConfig& config, CachedBVH bvh, const CachedBVH* inUse) {
+    // The entry replaced may still be drawn; it is then left unindexed for eviction to drop
+    auto existing = index.find(config);
+    if (existing != index.end()) {
+        if (&existing->second->second != inUse) {
+            totalBytes -= existing->second->second.bytes;
+            entries.erase(existing->second);
+        }
+        index.erase(existing);
+    }
+
+    bvh.bytes = bvh.arena.Bytes() + bvh.flat.Bytes() + bvh.objectRefs.capacity() * sizeof(Object*);
+    totalBytes += bvh.bytes;
+    entries.emplace_front(config, std::move(bvh));
+    index[config] = entries.begin();
+
+    // Evict from the back, keeping the entry just inserted and the one still being drawn
+    auto victim = std::prev(entries.end());
+    while (totalBytes > budgetBytes && victim != entries.begin()) {
+        auto previous = std::prev(victim);
+        if (&victim->second != inUse) {
+            auto indexed = index.find(victim->first);
+            if (indexed != index.end() && indexed->second == victim) {
+                index.erase(indexed);
+            }
+            totalBytes -= victim->second.bytes;
+            entries.erase(victim);
+        }
+        victim = previous;
+    }
+    return &entries.front().second;
+}
+
+void BVHCache::Clear() {
+    entries.clear(); // Each entry's arena frees its whole tree
+    index.clear();
+    totalBytes = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <climits>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "bvh.h"
+#include "nodearena.h"
+#include "ploc.h"
+#include "aac.h"
+#include "insertion.h"
+#include "flatbvh.h"
+
+// Memory the cache may hold before evicting least recently used trees
+#define BVH_CACHE_BUDGET_MB 256
+
+// Every setting that changes the shape of a built tree. Settings a method ignores are
+// left at their defaults so they do not split the cache. The bounding volume type is
+// not part of the key: every node stores all of its volumes, so switching type needs no rebuild.
+struct BVHConfig {
+    ConstructionMethod method = CM_TOP_DOWN;
+    SplitMethod splitMethod = SM_MEDIAN_CENTER;
+    AxisMethod axisMethod = AM_ROUND_ROBIN;
+    int kSplits = 2;
+    int heightCap = INT_MAX; // Top-down only; INT_MAX when unrestricted
+    bool collapseWide = false;
+    int bottomUpRadius = BOTTOM_UP_SEARCH_RADIUS; // Bottom-up only
+    MergeCostType bottomUpCost = MC_COMBINED;     // Bottom-up only
+    int mortonBits = 63;     // LBVH only
+    int plocRadius = PLOC_RADIUS;                 // PLOC only
+    PLOCDistance plocDistance = PD_SURFACE_AREA; // PLOC only
+    AACMode aacMode = AAC_HIGH_QUALITY;          // AAC only
+    bool optimizeTreelets = false;
+
+    bool operator==(const BVHConfig& other) const = default;
+};
+
+struct BVHConfigHash {
+    size_t operator()(const BVHConfig& config) const;
+};
+
+// A built tree, the arena holding its nodes and the object pointers its leaves read through,
+// with the flattened copy that queries and drawing use
+struct CachedBVH {
+    TreeNode* root = nullptr;
+    NodeArena arena;
+    std::vector<Object*> objectRefs; // The top-down builder's partitioned pointers into the scene; empty for other builders
+    FlatBVH flat;
+    size_t bytes = 0;
+};
+
+// Builds the tree described by config with its nodes in arena. Leaves reference objects, top-down
+// leaves through the pointers left in objectRefs, so both must outlive the tree.
+TreeNode* BuildBVH(NodeArena& arena, const BVHConfig& config, const std::vector<Object>& objects, std::vector<Object*>& objectRefs);
+// BuildBVH followed by flattening, skipped once the build is cancelled
+CachedBVH BuildCachedBVH(const BVHConfig& config, const std::vector<Object>& objects);
+
+// Built trees keyed by configuration, evicted least recently used first once over budget
+class BVHCache {
+public:
+    explicit BVHCache(size_t budgetBytes = static_cast<size_t>(BVH_CACHE_BUDGET_MB) << 20) : budgetBytes(budgetBytes) {}
+    ~BVHCache() { Clear(); }
+    BVHCache(const BVHCache&) = delete;
+    BVHCache& operator=(const BVHCache&) = delete;
+
+    // Cached tree for config, marked most recently used, or nullptr
+    const CachedBVH* Find(const BVHConfig& config);
+    // Cached tree for config, building and inserting it on a miss
+    const CachedBVH* Get(const BVHConfig& config, const std::vector<Object>& objects);
+    // Takes ownership of a built tree; may evict other entries but never this one or inUse
+    const CachedBVH* Insert(const BVHConfig& config, CachedBVH bvh, const CachedBVH* inUse = nullptr);
+    void Clear();
+
+    size_t Size() const { return entries.size(); }
+    size_t Bytes() const { return totalBytes; }
+
+private:
+    using Entry = std::pair<BVHConfig, CachedBVH>;
+    std::list<Entry> entries; // Most recently used first
+    std::unordered_map<BVHConfig, std::list<Entry>::iterator, BVHConfigHash> index;
+    size_t budgetBytes;
+    size_t totalBytes = 0;
+};
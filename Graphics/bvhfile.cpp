@@ -0,0 +1,215 @@
+#include "bvhfile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char BVH_FILE_MAGIC[8] = "FLATBVH";
+// Headers are compared byte for byte, so there must be no padding to differ
+static_assert(sizeof(BVHFileHeader) == 144, "BVHFileHeader must have no padding");
+
+// A whole file mapped read-only, unmapped once the last tree pointing into it is gone
+class FileMapping {
+public:
+    ~FileMapping();
+    // nullptr when the file is missing, empty or cannot be mapped
+    static std::shared_ptr<FileMapping> Open(const std::string& path);
+
+    const std::byte* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    FileMapping() = default;
+
+    const std::byte* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+FileMapping::~FileMapping() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+
+std::shared_ptr<FileMapping> FileMapping::Open(const std::string& path) {
+    std::shared_ptr<FileMapping> result(new FileMapping());
+    result->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (result->file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(result->file, &fileSize) || fileSize.QuadPart == 0) return nullptr;
+    result->mapping = CreateFileMappingA(result->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!result->mapping) return nullptr;
+    result->data = static_cast<const std::byte*>(MapViewOfFile(result->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!result->data) return nullptr;
+    result->size = static_cast<size_t>(fileSize.QuadPart);
+    return result;
+}
+#else
+FileMapping::~FileMapping() {
+    if (data) munmap(const_cast<std::byte*>(data), size);
+}
+
+std::shared_ptr<FileMapping> FileMapping::Open(const std::string& path) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return nullptr;
+
+    // The mapping stays valid once the descriptor is closed
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+    }
+    close(file);
+    if (data == MAP_FAILED) return nullptr;
+
+    std::shared_ptr<FileMapping> result(new FileMapping());
+    result->data = static_cast<const std::byte*>(data);
+    result->size = static_cast<size_t>(info.st_size);
+    return result;
+}
+#endif
+
+static void WriteConfig(const BVHConfig& config, int32_t (&fields)[16]) {
+    int32_t values[] = { config.method, config.splitMethod, config.axisMethod, config.kSplits, config.heightCap, config.collapseWide,
+        config.bottomUpRadius, config.bottomUpCost, config.mortonBits, config.plocRadius, config.plocDistance, config.aacMode,
+        config.optimizeTreelets };
+    static_assert(sizeof(values) <= sizeof(BVHFileHeader::config), "BVHConfig has more fields than the file header holds");
+    std::memset(fields, 0, sizeof(fields));
+    std::memcpy(fields, values, sizeof(values));
+}
+
+static BVHFileHeader MakeHeader(const BVHConfig& config, uint64_t sceneHash, int numNodes, int numPrimitives, int depth, int stackSize) {
+    BVHFileHeader header = {};
+    std::memcpy(header.magic, BVH_FILE_MAGIC, sizeof(header.magic));
+    header.endianTag = BVH_FILE_ENDIAN_TAG;
+    header.version = BVH_FILE_VERSION;
+    header.sceneHash = sceneHash;
+    WriteConfig(config, header.config);
+    header.structSizes[0] = sizeof(FlatLink);
+    header.structSizes[1] = sizeof(AABB);
+    header.structSizes[2] = sizeof(BoundingSphere);
+    header.structSizes[3] = sizeof(int);
+    header.bvhWidth = BVH_WIDTH;
+    header.numNodes = numNodes;
+    header.numPrimitives = numPrimitives;
+    header.depth = depth;
+    header.stackSize = stackSize;
+    // The block keeps the cache line alignment it has in memory
+    header.payloadOffset = (sizeof(BVHFileHeader) + 63) & ~static_cast<uint64_t>(63);
+    header.payloadBytes = ComputeFlatLayout(numNodes, numPrimitives).bytes;
+    return header;
+}
+
+uint64_t SceneHash(const std::vector<Object>& objects) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto combine = [&hash](const void* bytes, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            hash = (hash ^ static_cast<const unsigned char*>(bytes)[i]) * 0x100000001b3ull;
+        }
+        };
+    uint64_t numObjects = objects.size();
+    combine(&numObjects, sizeof(numObjects));
+    for (const auto& obj : objects) {
+        combine(&obj.boundingBox, sizeof(AABB));
+        combine(&obj.ritterSphere, sizeof(BoundingSphere));
+        combine(&obj.larssonSphere, sizeof(BoundingSphere));
+        combine(&obj.pcaSphere, sizeof(BoundingSphere));
+        uint64_t sizes[2] = { obj.mesh.Vertices.size(), obj.mesh.Indices.size() };
+        combine(sizes, sizeof(sizes));
+    }
+    return hash;
+}
+
+std::string BVHFilePath(const BVHFileStore& store, const BVHConfig& config) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx_%016llx.bvh", static_cast<unsigned long long>(store.sceneHash),
+        static_cast<unsigned long long>(BVHConfigHash()(config)));
+    return (std::filesystem::path(store.directory) / name).string();
+}
+
+bool SaveBVH(const std::string& path, const BVHConfig& config, const FlatBVH& flat, std::span<const Object> objects, uint64_t sceneHash) {
+    if (!flat.storage || flat.NodeCount() == 0 || flat.objects != objects.data()) return false;
+
+    BVHFileHeader header = MakeHeader(config, sceneHash, flat.NodeCount(), static_cast<int>(flat.primitives.size()), flat.depth, flat.stackSize);
+    FlatLayout layout = ComputeFlatLayout(header.numNodes, header.numPrimitives);
+
+    // Written beside the target and renamed over it, so a reader never maps half a file
+    std::string partial = path + ".partial";
+    {
+        std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        std::vector<char> padding(header.payloadOffset - sizeof(header), 0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding.data(), padding.size());
+        // The links start the block, which is written as it is in memory up to the end of the primitives
+        size_t used = layout.primitives + flat.primitives.size() * sizeof(int);
+        file.write(reinterpret_cast<const char*>(flat.links.data()), used);
+        padding.assign(layout.bytes - used, 0);
+        file.write(padding.data(), padding.size());
+        if (!file) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(partial, path, error);
+    if (error) {
+        std::filesystem::remove(partial, error);
+        return false;
+    }
+    return true;
+}
+
+bool LoadBVH(const std::string& path, const BVHConfig& config, std::span<const Object> objects, uint64_t sceneHash, FlatBVH& flat) {
+    std::shared_ptr<FileMapping> mapping = FileMapping::Open(path);
+    if (!mapping || mapping->Size() < sizeof(BVHFileHeader)) return false;
+
+    BVHFileHeader header;
+    std::memcpy(&header, mapping->Data(), sizeof(header));
+    if (header.numNodes <= 0 || header.numPrimitives < 0 || header.stackSize <= 0) return false;
+
+    // Every field but the counts must match what this build would write for the same tree
+    BVHFileHeader expected = MakeHeader(config, sceneHash, header.numNodes, header.numPrimitives, header.depth, header.stackSize);
+    if (std::memcmp(&header, &expected, sizeof(header)) != 0) return false;
+    if (header.payloadOffset + header.payloadBytes > mapping->Size()) return false;
+
+    flat = FlatBVH();
+    flat.Attach(mapping->Data() + header.payloadOffset, header.numNodes, header.numPrimitives);
+    flat.objects = objects.data();
+    flat.depth = header.depth;
+    flat.stackSize = header.stackSize;
+    flat.storage = std::move(mapping);
+    return true;
+}
+
+CachedBVH LoadOrBuildBVH(const BVHFileStore& store, const BVHConfig& config, const std::vector<Object>& objects) {
+    CachedBVH bvh;
+    if (store.directory.empty()) return BuildCachedBVH(config, objects);
+
+    std::string path = BVHFilePath(store, config);
+    if (LoadBVH(path, config, objects, store.sceneHash, bvh.flat)) return bvh;
+
+    bvh = BuildCachedBVH(config, objects);
+    if (!BuildCancelled() && bvh.root) {
+        std::error_code error;
+        std::filesystem::create_directories(store.directory, error);
+        SaveBVH(path, config, bvh.flat, objects, store.sceneHash);
+    }
+    return bvh;
+}
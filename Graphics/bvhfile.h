@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "bvhcache.h"
+#include "flatbvh.h"
+
+// Bumped whenever the header or the block layout changes; older files are rebuilt
+#define BVH_FILE_VERSION 2
+// Directory, relative to the working directory, that keeps built trees between runs
+#define BVH_FILE_DIRECTORY "bvhcache"
+// Reads back differently on a machine of the other byte order
+#define BVH_FILE_ENDIAN_TAG 0x01020304u
+
+// Start of a tree file, followed at payloadOffset by the FlatBVH block exactly as laid
+// out in memory, so loading maps the file and points the arrays into it. Every field is
+// written in the saving machine's byte order, which endianTag records.
+struct BVHFileHeader {
+    char magic[8];            // "FLATBVH"
+    uint32_t endianTag;       // BVH_FILE_ENDIAN_TAG as the saving machine stores it
+    uint32_t version;
+    uint64_t sceneHash;       // SceneHash of the objects the tree was built over
+    int32_t config[16];       // The BVHConfig that built the tree, one field per entry
+    uint32_t structSizes[4];  // sizeof FlatLink, AABB, BoundingSphere and int
+    int32_t bvhWidth;
+    int32_t numNodes;
+    int32_t numPrimitives;
+    int32_t depth;
+    int32_t stackSize;
+    uint32_t reserved;        // 0; keeps payloadOffset 8-byte aligned
+    uint64_t payloadOffset;
+    uint64_t payloadBytes;
+};
+
+// Identifies a scene by the bounding volumes and mesh sizes of its objects, in order
+uint64_t SceneHash(const std::vector<Object>& objects);
+
+// Where a scene's trees are kept between runs
+struct BVHFileStore {
+    std::string directory = BVH_FILE_DIRECTORY;
+    uint64_t sceneHash = 0;
+};
+std::string BVHFilePath(const BVHFileStore& store, const BVHConfig& config);
+
+// Writes flat with its primitives as indices into objects, the scene it was built over.
+// Fails for a tree built over any other array.
+bool SaveBVH(const std::string& path, const BVHConfig& config, const FlatBVH& flat, std::span<const Object> objects, uint64_t sceneHash);
+// Maps a file written by SaveBVH without reading its arrays. Fails unless the file
+// matches this build's version, byte order and struct sizes, and was built with
+// config over a scene with sceneHash.
+bool LoadBVH(const std::string& path, const BVHConfig& config, std::span<const Object> objects, uint64_t sceneHash, FlatBVH& flat);
+
+// The tree for config mapped from the store, or built and then saved there. Loaded
+// trees have only their flat arrays; root stays null.
+CachedBVH LoadOrBuildBVH(const BVHFileStore& store, const BVHConfig& config, const std::vector<Object>& objects);
@@ -0,0 +1,76 @@
+#include "bvhworker.h"
+
+BVHBuildWorker::BVHBuildWorker(const std::vector<Object>& objects, const BVHFileStore& store) : objects(objects), store(store) {
+    thread = std::thread(&BVHBuildWorker::Run, this);
+}
+
+BVHBuildWorker::~BVHBuildWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        pending.reset();
+        cancel = true;
+    }
+    wake.notify_one();
+    thread.join();
+    delete ready.exchange(nullptr);
+}
+
+void BVHBuildWorker::Request(const BVHConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (building && *building == config && !cancel) {
+            pending.reset(); // Already on its way
+            return;
+        }
+        if (pending && *pending == config) return;
+
+        pending = config;
+        if (building) {
+            cancel = true;
+        }
+    }
+    wake.notify_one();
+}
+
+std::unique_ptr<BVHBuildResult> BVHBuildWorker::TakeResult() {
+    return std::unique_ptr<BVHBuildResult>(ready.exchange(nullptr, std::memory_order_acquire));
+}
+
+bool BVHBuildWorker::Busy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending || building;
+}
+
+void BVHBuildWorker::Run() {
+    buildCancelFlag = &cancel;
+    while (true) {
+        BVHConfig config;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quit || pending; });
+            if (quit) break;
+            config = *pending;
+            pending.reset();
+            building = config;
+            cancel = false;
+        }
+
+        auto result = std::make_unique<BVHBuildResult>();
+        result->config = config;
+        result->bvh = LoadOrBuildBVH(store, config, objects);
+
+        bool cancelled;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = cancel;
+            building.reset();
+        }
+        if (cancelled) {
+            continue; // The result's arena frees the partial tree
+        }
+
+        // A result the render thread never picked up has been superseded by this one
+        delete ready.exchange(result.release(), std::memory_order_acq_rel);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "bvhcache.h"
+#include "bvhfile.h"
+
+// A finished background build, handed to the render thread for caching
+struct BVHBuildResult {
+    BVHConfig config;
+    CachedBVH bvh;
+};
+
+// Builds trees on a background thread so the render loop keeps drawing the
+// previous tree. A request for a different configuration cancels the build in
+// flight; cancelled trees are deleted on the worker and never published.
+class BVHBuildWorker {
+public:
+    // objects must not change while the worker exists. Trees are loaded from store when
+    // it has them and saved there after building.
+    BVHBuildWorker(const std::vector<Object>& objects, const BVHFileStore& store);
+    ~BVHBuildWorker();
+    BVHBuildWorker(const BVHBuildWorker&) = delete;
+    BVHBuildWorker& operator=(const BVHBuildWorker&) = delete;
+
+    // Start building config unless it is already being built; supersedes any other request
+    void Request(const BVHConfig& config);
+    // The most recent finished build, or nullptr. Called from the render thread.
+    std::unique_ptr<BVHBuildResult> TakeResult();
+    bool Busy();
+
+private:
+    void Run();
+
+    const std::vector<Object>& objects;
+    BVHFileStore store;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::optional<BVHConfig> pending;  // Latest request not yet started
+    std::optional<BVHConfig> building; // Configuration of the build in flight
+    bool quit = false;
+    std::atomic<bool> cancel{ false };
+    std::atomic<BVHBuildResult*> ready{ nullptr }; // Published with an atomic swap
+    std::thread thread;
+};
@@ -0,0 +1,342 @@
+#include "childtests.h"
+#include <algorithm>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it; MSVC needs no marking
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+// Child slots past BVH_WIDTH hold padding: every child array is 32-byte aligned, so a full
+// 4 or 8 lane load stays inside the node, and masking by numChildren drops the extra lanes.
+static_assert(alignof(TreeNode) >= 32, "Child bounds must allow aligned 8-lane loads");
+
+static int ValidChildren(const TreeNode& node) {
+    return (1 << node.numChildren) - 1;
+}
+
+// Lists the hit children nearest first
+static void SortHits(int mask, const float* tEntry, ChildHits& hits) {
+    hits.mask = mask;
+    hits.count = 0;
+    for (int i = 0; i < BVH_WIDTH; ++i) {
+        if (!(mask & (1 << i))) continue;
+
+        int j = hits.count++;
+        while (j > 0 && hits.tEntry[j - 1] > tEntry[i]) {
+            hits.tEntry[j] = hits.tEntry[j - 1];
+            hits.order[j] = hits.order[j - 1];
+            --j;
+        }
+        hits.tEntry[j] = tEntry[i];
+        hits.order[j] = i;
+    }
+}
+
+// Same results as _mm_min_ps and _mm_max_ps, NaN included, so scalar and SIMD kernels agree bit for bit
+static float MinLane(float a, float b) { return a < b ? a : b; }
+static float MaxLane(float a, float b) { return a > b ? a : b; }
+
+static void RayScalar(const TreeNode& node, const Ray& ray, const glm::vec3& invDir, float tMax, ChildHits& hits) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    float tEntry[BVH_WIDTH];
+    int mask = 0;
+    for (int i = 0; i < node.numChildren; ++i) {
+        float tNear = 0.0f;
+        float tFar = tMax;
+        for (int axis = 0; axis < 3; ++axis) {
+            float t0 = (mins[axis][i] - ray.start[axis]) * invDir[axis];
+            float t1 = (maxs[axis][i] - ray.start[axis]) * invDir[axis];
+            tNear = MaxLane(tNear, MinLane(t0, t1));
+            tFar = MinLane(tFar, MaxLane(t0, t1));
+        }
+        tEntry[i] = tNear;
+        mask |= (tNear <= tFar) << i;
+    }
+    SortHits(mask, tEntry, hits);
+}
+
+static int SphereScalar(const TreeNode& node, const BoundingSphere& sphere) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    int mask = 0;
+    for (int i = 0; i < node.numChildren; ++i) {
+        float distanceSq = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            float d = MaxLane(mins[axis][i] - sphere.center[axis], 0.0f) + MaxLane(sphere.center[axis] - maxs[axis][i], 0.0f);
+            distanceSq = distanceSq + d * d;
+        }
+        mask |= (distanceSq <= sphere.radius * sphere.radius) << i;
+    }
+    return mask;
+}
+
+static int BoxScalar(const TreeNode& node, const AABB& box) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    int mask = 0;
+    for (int i = 0; i < node.numChildren; ++i) {
+        bool overlap = true;
+        for (int axis = 0; axis < 3; ++axis) {
+            overlap = overlap && mins[axis][i] <= box.max[axis] && maxs[axis][i] >= box.min[axis];
+        }
+        mask |= overlap << i;
+    }
+    return mask;
+}
+
+static int FrustumScalar(const TreeNode& node, const Frustum& frustum) {
+    int mask = 0;
+    for (int i = 0; i < node.numChildren; ++i) {
+        bool inside = true;
+        for (const Plane& plane : frustum.planes) {
+            // The corner farthest along the plane normal
+            const glm::vec4& n = plane.normal;
+            float x = n.x >= 0.0f ? node.childMaxX[i] : node.childMinX[i];
+            float y = n.y >= 0.0f ? node.childMaxY[i] : node.childMinY[i];
+            float z = n.z >= 0.0f ? node.childMaxZ[i] : node.childMinZ[i];
+            inside = inside && n.x * x + n.y * y + n.z * z + n.w >= 0.0f;
+        }
+        mask |= inside << i;
+    }
+    return mask;
+}
+
+static void RaySSE(const TreeNode& node, const Ray& ray, const glm::vec3& invDir, float tMax, ChildHits& hits) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    alignas(16) float tEntry[BVH_WIDTH < 4 ? 4 : BVH_WIDTH];
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 4) {
+        __m128 tNear = _mm_setzero_ps();
+        __m128 tFar = _mm_set1_ps(tMax);
+        for (int axis = 0; axis < 3; ++axis) {
+            __m128 start = _mm_set1_ps(ray.start[axis]);
+            __m128 inv = _mm_set1_ps(invDir[axis]);
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(mins[axis] + base), start), inv);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(maxs[axis] + base), start), inv);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+            tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+        }
+        _mm_store_ps(tEntry + base, tNear);
+        mask |= _mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) << base;
+    }
+    SortHits(mask & ValidChildren(node), tEntry, hits);
+}
+
+static int SphereSSE(const TreeNode& node, const BoundingSphere& sphere) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    __m128 radiusSq = _mm_set1_ps(sphere.radius * sphere.radius);
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 4) {
+        __m128 distanceSq = _mm_setzero_ps();
+        for (int axis = 0; axis < 3; ++axis) {
+            __m128 center = _mm_set1_ps(sphere.center[axis]);
+            __m128 below = _mm_max_ps(_mm_sub_ps(_mm_load_ps(mins[axis] + base), center), _mm_setzero_ps());
+            __m128 above = _mm_max_ps(_mm_sub_ps(center, _mm_load_ps(maxs[axis] + base)), _mm_setzero_ps());
+            __m128 d = _mm_add_ps(below, above);
+            distanceSq = _mm_add_ps(distanceSq, _mm_mul_ps(d, d));
+        }
+        mask |= _mm_movemask_ps(_mm_cmple_ps(distanceSq, radiusSq)) << base;
+    }
+    return mask & ValidChildren(node);
+}
+
+static int BoxSSE(const TreeNode& node, const AABB& box) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 4) {
+        __m128 overlap = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int axis = 0; axis < 3; ++axis) {
+            __m128 below = _mm_cmple_ps(_mm_load_ps(mins[axis] + base), _mm_set1_ps(box.max[axis]));
+            __m128 above = _mm_cmpge_ps(_mm_load_ps(maxs[axis] + base), _mm_set1_ps(box.min[axis]));
+            overlap = _mm_and_ps(overlap, _mm_and_ps(below, above));
+        }
+        mask |= _mm_movemask_ps(overlap) << base;
+    }
+    return mask & ValidChildren(node);
+}
+
+static int FrustumSSE(const TreeNode& node, const Frustum& frustum) {
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 4) {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const Plane& plane : frustum.planes) {
+            // The normal's signs pick the same corner for every child
+            const glm::vec4& n = plane.normal;
+            __m128 x = _mm_load_ps((n.x >= 0.0f ? node.childMaxX : node.childMinX) + base);
+            __m128 y = _mm_load_ps((n.y >= 0.0f ? node.childMaxY : node.childMinY) + base);
+            __m128 z = _mm_load_ps((n.z >= 0.0f ? node.childMaxZ : node.childMinZ) + base);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(n.x), x), _mm_mul_ps(_mm_set1_ps(n.y), y)),
+                _mm_mul_ps(_mm_set1_ps(n.z), z)), _mm_set1_ps(n.w));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        }
+        mask |= _mm_movemask_ps(inside) << base;
+    }
+    return mask & ValidChildren(node);
+}
+
+AVX2_TARGET static void RayAVX2(const TreeNode& node, const Ray& ray, const glm::vec3& invDir, float tMax, ChildHits& hits) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    alignas(32) float tEntry[BVH_WIDTH < 8 ? 8 : BVH_WIDTH];
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 8) {
+        __m256 tNear = _mm256_setzero_ps();
+        __m256 tFar = _mm256_set1_ps(tMax);
+        for (int axis = 0; axis < 3; ++axis) {
+            __m256 start = _mm256_set1_ps(ray.start[axis]);
+            __m256 inv = _mm256_set1_ps(invDir[axis]);
+            __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(mins[axis] + base), start), inv);
+            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(maxs[axis] + base), start), inv);
+            tNear = _mm256_max_ps(tNear, _mm256_min_ps(t0, t1));
+            tFar = _mm256_min_ps(tFar, _mm256_max_ps(t0, t1));
+        }
+        _mm256_store_ps(tEntry + base, tNear);
+        mask |= _mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ)) << base;
+    }
+    // SortHits is compiled without AVX; clearing the upper halves avoids a transition stall
+    _mm256_zeroupper();
+    SortHits(mask & ValidChildren(node), tEntry, hits);
+}
+
+AVX2_TARGET static int SphereAVX2(const TreeNode& node, const BoundingSphere& sphere) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    __m256 radiusSq = _mm256_set1_ps(sphere.radius * sphere.radius);
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 8) {
+        __m256 distanceSq = _mm256_setzero_ps();
+        for (int axis = 0; axis < 3; ++axis) {
+            __m256 center = _mm256_set1_ps(sphere.center[axis]);
+            __m256 below = _mm256_max_ps(_mm256_sub_ps(_mm256_load_ps(mins[axis] + base), center), _mm256_setzero_ps());
+            __m256 above = _mm256_max_ps(_mm256_sub_ps(center, _mm256_load_ps(maxs[axis] + base)), _mm256_setzero_ps());
+            __m256 d = _mm256_add_ps(below, above);
+            distanceSq = _mm256_add_ps(distanceSq, _mm256_mul_ps(d, d));
+        }
+        mask |= _mm256_movemask_ps(_mm256_cmp_ps(distanceSq, radiusSq, _CMP_LE_OQ)) << base;
+    }
+    return mask & ValidChildren(node);
+}
+
+AVX2_TARGET static int BoxAVX2(const TreeNode& node, const AABB& box) {
+    const float* mins[3] = { node.childMinX, node.childMinY, node.childMinZ };
+    const float* maxs[3] = { node.childMaxX, node.childMaxY, node.childMaxZ };
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 8) {
+        __m256 overlap = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int axis = 0; axis < 3; ++axis) {
+            __m256 below = _mm256_cmp_ps(_mm256_load_ps(mins[axis] + base), _mm256_set1_ps(box.max[axis]), _CMP_LE_OQ);
+            __m256 above = _mm256_cmp_ps(_mm256_load_ps(maxs[axis] + base), _mm256_set1_ps(box.min[axis]), _CMP_GE_OQ);
+            overlap = _mm256_and_ps(overlap, _mm256_and_ps(below, above));
+        }
+        mask |= _mm256_movemask_ps(overlap) << base;
+    }
+    return mask & ValidChildren(node);
+}
+
+AVX2_TARGET static int FrustumAVX2(const TreeNode& node, const Frustum& frustum) {
+    int mask = 0;
+    for (int base = 0; base < BVH_WIDTH; base += 8) {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const Plane& plane : frustum.planes) {
+            const glm::vec4& n = plane.normal;
+            __m256 x = _mm256_load_ps((n.x >= 0.0f ? node.childMaxX : node.childMinX) + base);
+            __m256 y = _mm256_load_ps((n.y >= 0.0f ? node.childMaxY : node.childMinY) + base);
+            __m256 z = _mm256_load_ps((n.z >= 0.0f ? node.childMaxZ : node.childMinZ) + base);
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(n.x), x), _mm256_mul_ps(_mm256_set1_ps(n.y), y)),
+                _mm256_mul_ps(_mm256_set1_ps(n.z), z)), _mm256_set1_ps(n.w));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        mask |= _mm256_movemask_ps(inside) << base;
+    }
+    return mask & ValidChildren(node);
+}
+
+static const ChildTestKernels scalarKernels = { "Scalar", 1, RayScalar, SphereScalar, BoxScalar, FrustumScalar };
+static const ChildTestKernels sseKernels = { "SSE", 4, RaySSE, SphereSSE, BoxSSE, FrustumSSE };
+static const ChildTestKernels avx2Kernels = { "AVX2", 8, RayAVX2, SphereAVX2, BoxAVX2, FrustumAVX2 };
+
+SimdLevel DetectSimdLevel() {
+    // SSE2 is part of both x64 and the project's Win32 target
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool osSavesAVX = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = info[1] & (1 << 5);
+    }
+    return osSavesAVX && avx2 ? SIMD_AVX2 : SIMD_SSE;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE;
+#endif
+}
+
+const ChildTestKernels& ChildTests(SimdLevel level) {
+    static const SimdLevel supported = DetectSimdLevel();
+    SimdLevel usable = std::min(level, supported);
+    if (usable == SIMD_AVX2) return avx2Kernels;
+    if (usable == SIMD_SSE) return sseKernels;
+    return scalarKernels;
+}
+
+const ChildTestKernels& ActiveChildTests() {
+    static const ChildTestKernels& kernels = ChildTests(BVH_WIDTH > 4 ? SIMD_AVX2 : SIMD_SSE);
+    return kernels;
+}
+
+static void LeafOverlaps(const TreeNode* leaf, const BoundingSphere* sphere, const Frustum* frustum, std::vector<const Object*>& results) {
+    for (int i = 0; i < leaf->numObjects; ++i) {
+        const Object& obj = leaf->LeafObject(i);
+        if (sphere ? SphereAABBOverlap(*sphere, obj.boundingBox) : AABBInFrustum(*frustum, obj.boundingBox)) {
+            results.push_back(&obj);
+        }
+    }
+}
+
+static void SphereOverlapNode(const ChildTestKernels& kernels, const TreeNode* node, const BoundingSphere& sphere, std::vector<const Object*>& results) {
+    if (node->type == LEAF) {
+        LeafOverlaps(node, &sphere, nullptr, results);
+        return;
+    }
+    int mask = kernels.sphere(*node, sphere);
+    for (int i = 0; i < node->numChildren; ++i) {
+        if (mask & (1 << i)) SphereOverlapNode(kernels, node->children[i], sphere, results);
+    }
+}
+
+void SphereOverlapTree(TreeNode* root, const BoundingSphere& sphere, std::vector<const Object*>& results) {
+    if (root && SphereAABBOverlap(sphere, root->aabbVolume)) {
+        SphereOverlapNode(ActiveChildTests(), root, sphere, results);
+    }
+}
+
+static void FrustumCullNode(const ChildTestKernels& kernels, const TreeNode* node, const Frustum& frustum, std::vector<const Object*>& results) {
+    if (node->type == LEAF) {
+        LeafOverlaps(node, nullptr, &frustum, results);
+        return;
+    }
+    int mask = kernels.frustum(*node, frustum);
+    for (int i = 0; i < node->numChildren; ++i) {
+        if (mask & (1 << i)) FrustumCullNode(kernels, node->children[i], frustum, results);
+    }
+}
+
+void FrustumCullTree(TreeNode* root, const Frustum& frustum, std::vector<const Object*>& results) {
+    if (root && AABBInFrustum(frustum, root->aabbVolume)) {
+        FrustumCullNode(ActiveChildTests(), root, frustum, results);
+    }
+}
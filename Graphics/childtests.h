@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+// Children of one node that a ray enters, nearest first, with the distance at which the ray enters each
+struct ChildHits {
+    int mask = 0; // Bit i set when child i is hit
+    int count = 0;
+    int order[BVH_WIDTH];
+    float tEntry[BVH_WIDTH];
+};
+
+// One implementation of the tests of a query against every child box of a node, read from
+// the node's SoA child bounds. The masks have bit i set when child i passes.
+struct ChildTestKernels {
+    const char* name;
+    int lanes; // Child boxes tested per instruction
+    void (*ray)(const TreeNode& node, const Ray& ray, const glm::vec3& invDir, float tMax, ChildHits& hits);
+    int (*sphere)(const TreeNode& node, const BoundingSphere& sphere);
+    int (*box)(const TreeNode& node, const AABB& box);
+    int (*frustum)(const TreeNode& node, const Frustum& frustum);
+};
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE,
+    SIMD_AVX2
+};
+
+// Widest instruction set the CPU and operating system support
+SimdLevel DetectSimdLevel();
+// Kernels for level, or for the widest supported level below it. Every level returns the
+// same results, so the scalar kernels can verify the others.
+const ChildTestKernels& ChildTests(SimdLevel level);
+// Kernels picked once for this CPU, used by the tree queries. 8-lane kernels are only
+// picked for trees wider than 4, where they test a whole node at once.
+const ChildTestKernels& ActiveChildTests();
+
+// Objects whose AABB overlaps the sphere, or is at least partly inside the frustum
+void SphereOverlapTree(TreeNode* root, const BoundingSphere& sphere, std::vector<const Object*>& results);
+void FrustumCullTree(TreeNode* root, const Frustum& frustum, std::vector<const Object*>& results);
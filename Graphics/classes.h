@@ -20,21 +20,24 @@ struct Triangle
 
 struct BoundingSphere
 {
-    glm::vec3 position;
+    glm::vec3 center;
     float radius;
 };
 
 struct AABB
 {
-    glm::vec3 center;
-    glm::vec3 halfExtents;
     glm::vec3 min;
     glm::vec3 max;
-    GLuint VAO, VBO, EBO;
 };
 
 struct Ray
 {
     glm::vec3 start;
     glm::vec3 direction;
-};
\ No newline at end of file
+};
+
+// Points p inside satisfy dot(normal.xyz, p) + normal.w >= 0 for every plane
+struct Frustum
+{
+    Plane planes[6]; // Left, right, bottom, top, near, far
+};
@@ -0,0 +1,284 @@
+#include "flatbvh.h"
+#include <algorithm>
+
+// Arrays of a tree being flattened, filled front to back
+struct FlatBuilder {
+    FlatLink* links;
+    AABB* aabbVolumes;
+    BoundingSphere* ritterVolumes;
+    BoundingSphere* larssonVolumes;
+    BoundingSphere* pcaVolumes;
+    int* primitives;
+    const Object* objects;
+    int numNodes = 0;
+    int numPrimitives = 0;
+    int depth = 0;
+    int stackSize = 0;
+};
+
+// Nodes left once empty leaves are dropped, and the object references in their leaves
+static int CountFlatNodes(const TreeNode* node, int& numPrimitives) {
+    if (node->type == LEAF) {
+        numPrimitives += node->numObjects;
+        return node->numObjects > 0 ? 1 : 0;
+    }
+
+    int count = 1;
+    for (int i = 0; i < node->numChildren; ++i) {
+        count += CountFlatNodes(node->children[i], numPrimitives);
+    }
+    return count;
+}
+
+// pending counts the entries a traversal stack holds below node once node is popped: the
+// siblings of node and of each of its ancestors, left for later
+static void FlattenNode(FlatBuilder& bvh, const TreeNode* node, int depth, int pending) {
+    if (node->type == LEAF && node->numObjects == 0) return;
+
+    int index = bvh.numNodes++;
+    bvh.aabbVolumes[index] = node->aabbVolume;
+    bvh.ritterVolumes[index] = node->ritterVolume;
+    bvh.larssonVolumes[index] = node->larssonVolume;
+    bvh.pcaVolumes[index] = node->pcaVolume;
+    bvh.depth = std::max(bvh.depth, depth + 1);
+
+    if (node->type == LEAF) {
+        bvh.links[index] = { bvh.numPrimitives, node->numObjects };
+        for (int i = 0; i < node->numObjects; ++i) {
+            bvh.primitives[bvh.numPrimitives++] = static_cast<int>(&node->LeafObject(i) - bvh.objects);
+        }
+        return;
+    }
+
+    int numChildren = 0;
+    for (int i = 0; i < node->numChildren; ++i) {
+        const TreeNode* child = node->children[i];
+        numChildren += child->type != LEAF || child->numObjects > 0;
+    }
+    bvh.stackSize = std::max(bvh.stackSize, pending + numChildren);
+    for (int i = 0; i < node->numChildren; ++i) {
+        FlattenNode(bvh, node->children[i], depth + 1, pending + numChildren - 1);
+    }
+    bvh.links[index] = { bvh.numNodes, 0 };
+}
+
+static size_t AlignToCacheLine(size_t offset) {
+    return (offset + 63) & ~static_cast<size_t>(63);
+}
+
+FlatLayout ComputeFlatLayout(int numNodes, int numPrimitives) {
+    FlatLayout layout;
+    size_t offset = 0;
+    auto place = [&offset](size_t bytes) {
+        size_t start = offset;
+        offset = AlignToCacheLine(offset + bytes);
+        return start;
+        };
+    layout.links = place(numNodes * sizeof(FlatLink));
+    layout.aabbVolumes = place(numNodes * sizeof(AABB));
+    layout.ritterVolumes = place(numNodes * sizeof(BoundingSphere));
+    layout.larssonVolumes = place(numNodes * sizeof(BoundingSphere));
+    layout.pcaVolumes = place(numNodes * sizeof(BoundingSphere));
+    layout.primitives = place(numPrimitives * sizeof(int));
+    layout.bytes = offset;
+    return layout;
+}
+
+void FlatBVH::Attach(const std::byte* block, int numNodes, int numPrimitives) {
+    FlatLayout layout = ComputeFlatLayout(numNodes, numPrimitives);
+    links = { reinterpret_cast<const FlatLink*>(block + layout.links), static_cast<size_t>(numNodes) };
+    aabbVolumes = { reinterpret_cast<const AABB*>(block + layout.aabbVolumes), static_cast<size_t>(numNodes) };
+    ritterVolumes = { reinterpret_cast<const BoundingSphere*>(block + layout.ritterVolumes), static_cast<size_t>(numNodes) };
+    larssonVolumes = { reinterpret_cast<const BoundingSphere*>(block + layout.larssonVolumes), static_cast<size_t>(numNodes) };
+    pcaVolumes = { reinterpret_cast<const BoundingSphere*>(block + layout.pcaVolumes), static_cast<size_t>(numNodes) };
+    primitives = { reinterpret_cast<const int*>(block + layout.primitives), static_cast<size_t>(numPrimitives) };
+}
+
+FlatBVH FlattenBVH(TreeNode* root, std::span<const Object> objects) {
+    FlatBVH bvh;
+    bvh.objects = objects.data();
+    if (!root) return bvh;
+
+    int numPrimitives = 0;
+    int numNodes = CountFlatNodes(root, numPrimitives);
+    FlatLayout layout = ComputeFlatLayout(numNodes, numPrimitives);
+    std::shared_ptr<std::byte[]> block(new std::byte[layout.bytes]);
+
+    FlatBuilder builder;
+    builder.links = reinterpret_cast<FlatLink*>(block.get() + layout.links);
+    builder.aabbVolumes = reinterpret_cast<AABB*>(block.get() + layout.aabbVolumes);
+    builder.ritterVolumes = reinterpret_cast<BoundingSphere*>(block.get() + layout.ritterVolumes);
+    builder.larssonVolumes = reinterpret_cast<BoundingSphere*>(block.get() + layout.larssonVolumes);
+    builder.pcaVolumes = reinterpret_cast<BoundingSphere*>(block.get() + layout.pcaVolumes);
+    builder.primitives = reinterpret_cast<int*>(block.get() + layout.primitives);
+    builder.objects = objects.data();
+    builder.stackSize = 1;
+    FlattenNode(builder, root, 0, 0);
+
+    bvh.Attach(block.get(), builder.numNodes, builder.numPrimitives);
+    bvh.depth = builder.depth;
+    bvh.stackSize = builder.stackSize;
+    bvh.storage = std::move(block);
+    return bvh;
+}
+
+std::span<const BoundingSphere> FlatBVH::Spheres(BoundingVolumeType bvType) const {
+    switch (bvType) {
+    case BVT_LARSSON_SPHERE:
+        return larssonVolumes;
+    case BVT_PCA_SPHERE:
+        return pcaVolumes;
+    default:
+        return ritterVolumes;
+    }
+}
+
+size_t FlatBVH::Bytes() const {
+    return storage ? ComputeFlatLayout(NodeCount(), static_cast<int>(primitives.size())).bytes : 0;
+}
+
+static const BoundingSphere& ObjectSphere(const Object& obj, BoundingVolumeType bvType) {
+    switch (bvType) {
+    case BVT_LARSSON_SPHERE:
+        return obj.larssonSphere;
+    case BVT_PCA_SPHERE:
+        return obj.pcaSphere;
+    default:
+        return obj.ritterSphere;
+    }
+}
+
+static bool SpheresOverlap(const BoundingSphere& a, const BoundingSphere& b) {
+    glm::vec3 offset = a.center - b.center;
+    float reach = a.radius + b.radius;
+    return glm::dot(offset, offset) <= reach * reach;
+}
+
+bool FlatRayCast(const FlatBVH& bvh, const Ray& ray, float tMax, RayHit& hit) {
+    glm::vec3 invDir = 1.0f / ray.direction;
+    bool found = false;
+    int numNodes = bvh.NodeCount();
+    for (int i = 0; i < numNodes;) {
+        const FlatLink& link = bvh.links[i];
+        float tEntry;
+        if (!RayIntersectsAABB(ray, invDir, bvh.aabbVolumes[i], tMax, tEntry)) {
+            i = SkipIndex(link, i);
+            continue;
+        }
+
+        for (int p = link.skipOrFirst; p < link.skipOrFirst + link.count; ++p) {
+            const Object& obj = bvh.objects[bvh.primitives[p]];
+            int triangle;
+            float u, v;
+            if (obj.blas && BLASRayCast(*obj.blas, ray, tMax, triangle, u, v)) {
+                hit = { &obj, triangle, tMax, u, v };
+                found = true;
+            }
+        }
+        ++i;
+    }
+    return found;
+}
+
+void FlatOverlap(const FlatBVH& bvh, const AABB& box, std::vector<const Object*>& results) {
+    int numNodes = bvh.NodeCount();
+    for (int i = 0; i < numNodes;) {
+        const FlatLink& link = bvh.links[i];
+        if (!AABBOverlap(bvh.aabbVolumes[i], box)) {
+            i = SkipIndex(link, i);
+            continue;
+        }
+
+        for (int p = link.skipOrFirst; p < link.skipOrFirst + link.count; ++p) {
+            const Object& obj = bvh.objects[bvh.primitives[p]];
+            if (AABBOverlap(obj.boundingBox, box) && obj.blas && BLASOverlaps(*obj.blas, box)) {
+                results.push_back(&obj);
+            }
+        }
+        ++i;
+    }
+}
+
+int FlatRayNodeVisits(const FlatBVH& bvh, const Ray& ray, float tMax) {
+    glm::vec3 invDir = 1.0f / ray.direction;
+    int visits = 0;
+    int numNodes = bvh.NodeCount();
+    for (int i = 0; i < numNodes; ++visits) {
+        float tEntry;
+        i = RayIntersectsAABB(ray, invDir, bvh.aabbVolumes[i], tMax, tEntry) ? i + 1 : SkipIndex(bvh.links[i], i);
+    }
+    return visits;
+}
+
+int FlatOverlapNodeVisits(const FlatBVH& bvh, const AABB& box) {
+    int visits = 0;
+    int numNodes = bvh.NodeCount();
+    for (int i = 0; i < numNodes; ++visits) {
+        i = AABBOverlap(bvh.aabbVolumes[i], box) ? i + 1 : SkipIndex(bvh.links[i], i);
+    }
+    return visits;
+}
+
+void FlatOverlap(const FlatBVH& bvh, const BoundingSphere& sphere, BoundingVolumeType bvType, std::vector<const Object*>& results) {
+    std::span<const BoundingSphere> volumes = bvh.Spheres(bvType);
+    int numNodes = bvh.NodeCount();
+    for (int i = 0; i < numNodes;) {
+        const FlatLink& link = bvh.links[i];
+        if (!SpheresOverlap(volumes[i], sphere)) {
+            i = SkipIndex(link, i);
+            continue;
+        }
+
+        for (int p = link.skipOrFirst; p < link.skipOrFirst + link.count; ++p) {
+            const Object& obj = bvh.objects[bvh.primitives[p]];
+            if (SpheresOverlap(ObjectSphere(obj, bvType), sphere)) {
+                results.push_back(&obj);
+            }
+        }
+        ++i;
+    }
+}
+
+int FlatOverlapNodeVisits(const FlatBVH& bvh, const BoundingSphere& sphere, BoundingVolumeType bvType) {
+    std::span<const BoundingSphere> volumes = bvh.Spheres(bvType);
+    int visits = 0;
+    int numNodes = bvh.NodeCount();
+    for (int i = 0; i < numNodes; ++visits) {
+        i = SpheresOverlap(volumes[i], sphere) ? i + 1 : SkipIndex(bvh.links[i], i);
+    }
+    return visits;
+}
+
+int FlatFrustumCull(const FlatBVH& bvh, const Frustum& frustum, std::vector<int>& visible) {
+    int visits = 0;
+    int numNodes = bvh.NodeCount();
+    for (int i = 0; i < numNodes; ++visits) {
+        const FlatLink& link = bvh.links[i];
+        FrustumClass inFrustum = ClassifyAABB(frustum, bvh.aabbVolumes[i]);
+        if (inFrustum == FC_OUTSIDE) {
+            i = SkipIndex(link, i);
+            continue;
+        }
+
+        if (inFrustum == FC_INSIDE) {
+            // Every leaf below is visible; collect them without another test
+            int end = SkipIndex(link, i);
+            for (; i < end; ++i) {
+                const FlatLink& leaf = bvh.links[i];
+                if (leaf.count > 0) {
+                    auto first = bvh.primitives.begin() + leaf.skipOrFirst;
+                    visible.insert(visible.end(), first, first + leaf.count);
+                }
+            }
+            continue;
+        }
+
+        for (int p = link.skipOrFirst; p < link.skipOrFirst + link.count; ++p) {
+            if (AABBInFrustum(frustum, bvh.objects[bvh.primitives[p]].boundingBox)) {
+                visible.push_back(bvh.primitives[p]);
+            }
+        }
+        ++i;
+    }
+    return visits;
+}
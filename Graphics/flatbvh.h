@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+#include "bvh.h"
+#include "blas.h"
+
+// Topology of a flattened node. Nodes are stored depth first, so an internal node's first
+// child follows it directly and each further child starts at the previous child's skip
+// index. In a binary tree the right child is the left child's skip.
+struct FlatLink {
+    int skipOrFirst; // Internal nodes: index just past the subtree. Leaves: first entry in primitives.
+    int count;       // Objects in a leaf; 0 for internal nodes
+};
+
+// Where a traversal that does not enter node i continues. A leaf's subtree is itself.
+inline int SkipIndex(const FlatLink& link, int i) {
+    return link.count > 0 ? i + 1 : link.skipOrFirst;
+}
+
+// Byte offset of each array of a flattened tree within its single block, every array
+// starting on a cache line. Files store the block exactly as laid out here.
+struct FlatLayout {
+    size_t links, aabbVolumes, ritterVolumes, larssonVolumes, pcaVolumes, primitives;
+    size_t bytes;
+};
+FlatLayout ComputeFlatLayout(int numNodes, int numPrimitives);
+
+// A built tree compiled into parallel arrays indexed by node: the topology and one stream
+// per kind of bounding volume. A query reads the links and only the volumes it tests,
+// walking front to back without a stack and jumping ahead past subtrees it rejects.
+// The arrays are views into one block, either built in memory or mapped from a file;
+// copies share the block.
+struct FlatBVH {
+    std::span<const FlatLink> links;
+    std::span<const AABB> aabbVolumes;
+    std::span<const BoundingSphere> ritterVolumes;
+    std::span<const BoundingSphere> larssonVolumes;
+    std::span<const BoundingSphere> pcaVolumes;
+
+    std::span<const int> primitives; // Objects of each leaf, as indices into objects
+    const Object* objects = nullptr; // The array the tree's leaves pointed into
+    int depth = 0;
+    int stackSize = 0;               // Most entries a stack holds when a query pushes every child of each node it enters
+
+    std::shared_ptr<const void> storage; // Owns the block the arrays point into
+
+    int NodeCount() const { return static_cast<int>(links.size()); }
+    // The sphere stream for a sphere type
+    std::span<const BoundingSphere> Spheres(BoundingVolumeType bvType) const;
+    size_t Bytes() const;
+    // Points the arrays into block, which is laid out by ComputeFlatLayout
+    void Attach(const std::byte* block, int numNodes, int numPrimitives);
+};
+
+// Compiles root into depth-first order. Every leaf must point into objects, which must
+// outlive the result. Empty leaves hold nothing to find and are dropped.
+FlatBVH FlattenBVH(TreeNode* root, std::span<const Object> objects);
+
+// Same queries as RayCastTree, OverlapTree, RayNodeVisits and OverlapNodeVisits
+bool FlatRayCast(const FlatBVH& bvh, const Ray& ray, float tMax, RayHit& hit);
+void FlatOverlap(const FlatBVH& bvh, const AABB& box, std::vector<const Object*>& results);
+int FlatRayNodeVisits(const FlatBVH& bvh, const Ray& ray, float tMax);
+int FlatOverlapNodeVisits(const FlatBVH& bvh, const AABB& box);
+
+// Objects whose sphere of the given type overlaps sphere, culling with the nodes' spheres of that
+// type. Exact for the builders that merge child spheres; top-down spheres are fit to the vertices
+// below them and need not enclose the objects' own spheres.
+void FlatOverlap(const FlatBVH& bvh, const BoundingSphere& sphere, BoundingVolumeType bvType, std::vector<const Object*>& results);
+int FlatOverlapNodeVisits(const FlatBVH& bvh, const BoundingSphere& sphere, BoundingVolumeType bvType);
+
+// Appends the objects whose boxes pass AABBInFrustum, as indices into bvh.objects, and returns
+// the nodes tested. A node wholly inside the frustum has all of its objects accepted untested,
+// and one wholly outside a plane is skipped with its subtree.
+int FlatFrustumCull(const FlatBVH& bvh, const Frustum& frustum, std::vector<int>& visible);
@@ -0,0 +1,123 @@
+#include "insertion.h"
+#include "nodearena.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+
+// Candidate sibling reached by the search, with its parent's entry for walking back up
+struct InsertionEntry {
+    TreeNode* node;
+    int parent;        // -1 for the root
+    float inducedCost; // Area the ancestors grow by if the leaf is placed below them
+};
+
+// Scratch space reused across insertions
+struct InsertionSearch {
+    std::vector<InsertionEntry> entries;
+    std::vector<std::pair<float, int>> queue; // Lower bound on total cost, entry index
+};
+
+static void RefitNode(TreeNode* node) {
+    TreeNode* first = node->children[0];
+    node->aabbVolume = first->aabbVolume;
+    node->ritterVolume = first->ritterVolume;
+    node->larssonVolume = first->larssonVolume;
+    node->pcaVolume = first->pcaVolume;
+    node->numObjects = first->numObjects;
+    for (int i = 1; i < node->numChildren; ++i) {
+        TreeNode* child = node->children[i];
+        node->aabbVolume = MergeAABB(node->aabbVolume, child->aabbVolume);
+        node->ritterVolume = MergeBoundingSpheres(node->ritterVolume, child->ritterVolume);
+        node->larssonVolume = MergeBoundingSpheres(node->larssonVolume, child->larssonVolume);
+        node->pcaVolume = MergeBoundingSpheres(node->pcaVolume, child->pcaVolume);
+        node->numObjects += child->numObjects;
+    }
+    node->UpdateChildBounds();
+}
+
+static void InsertLeaf(NodeArena& arena, TreeNode*& root, TreeNode* leaf, InsertionSearch& search) {
+    if (!root) {
+        root = leaf;
+        return;
+    }
+
+    // Placing the leaf beside a node costs the area of their new parent plus the induced cost.
+    // Below a node every placement also grows that node's box, so the leaf's own area on top of
+    // the children's induced cost bounds everything in its subtree.
+    float leafArea = SurfaceArea(leaf->aabbVolume);
+    auto greater = std::greater<std::pair<float, int>>();
+    search.entries.assign(1, { root, -1, 0.0f });
+    search.queue.assign(1, { leafArea, 0 });
+    float bestCost = std::numeric_limits<float>::max();
+    int best = 0;
+
+    while (!search.queue.empty() && search.queue.front().first < bestCost) {
+        std::pop_heap(search.queue.begin(), search.queue.end(), greater);
+        int index = search.queue.back().second;
+        search.queue.pop_back();
+
+        InsertionEntry entry = search.entries[index];
+        float mergedArea = SurfaceArea(MergeAABB(entry.node->aabbVolume, leaf->aabbVolume));
+        float cost = entry.inducedCost + mergedArea;
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = index;
+        }
+
+        if (entry.node->type == LEAF) continue;
+        float childInduced = entry.inducedCost + mergedArea - SurfaceArea(entry.node->aabbVolume);
+        if (childInduced + leafArea >= bestCost) continue;
+        for (int i = 0; i < entry.node->numChildren; ++i) {
+            search.entries.push_back({ entry.node->children[i], index, childInduced });
+            search.queue.push_back({ childInduced + leafArea, static_cast<int>(search.entries.size()) - 1 });
+            std::push_heap(search.queue.begin(), search.queue.end(), greater);
+        }
+    }
+
+    // The new parent takes the sibling's place, then every ancestor grows to cover the leaf
+    TreeNode* sibling = search.entries[best].node;
+    TreeNode* parent = arena.New(sibling, leaf);
+    int ancestor = search.entries[best].parent;
+    if (ancestor < 0) {
+        root = parent;
+        return;
+    }
+
+    TreeNode* node = search.entries[ancestor].node;
+    *std::find(node->children, node->children + node->numChildren, sibling) = parent;
+    for (; ancestor >= 0; ancestor = search.entries[ancestor].parent) {
+        RefitNode(search.entries[ancestor].node);
+    }
+}
+
+static TreeNode* NewLeaf(NodeArena& arena, const Object& object) {
+    TreeNode* leaf = arena.New();
+    leaf->aabbVolume = object.boundingBox;
+    leaf->ritterVolume = object.ritterSphere;
+    leaf->larssonVolume = object.larssonSphere;
+    leaf->pcaVolume = object.pcaSphere;
+    leaf->objects = const_cast<Object*>(&object);
+    leaf->numObjects = 1;
+    return leaf;
+}
+
+void InsertObject(NodeArena& arena, TreeNode*& root, const Object& object) {
+    InsertionSearch search;
+    InsertLeaf(arena, root, NewLeaf(arena, object), search);
+}
+
+TreeNode* InsertionTree(NodeArena& arena, const std::vector<Object>& objects) {
+    std::vector<int> order(objects.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+    TreeNode* root = nullptr;
+    InsertionSearch search;
+    for (int index : order) {
+        if (BuildCancelled()) break;
+        InsertLeaf(arena, root, NewLeaf(arena, objects[index]), search);
+    }
+    return root;
+}
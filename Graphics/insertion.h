@@ -0,0 +1,17 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+// Incremental construction (Goldsmith and Salmon 1987). Objects are inserted one at a time,
+// each as the sibling of the node whose choice adds the least surface area to the tree: the
+// area of the new parent plus the growth of every ancestor's box. The position is found by
+// branch and bound (Bittner et al. 2013), expanding the cheapest partial path first and
+// pruning subtrees whose ancestors alone already cost more than the best position found.
+
+// Inserts one object into the tree rooted at root, which may be null or any tree built by
+// another method. The object must outlive the tree; new nodes come from arena.
+void InsertObject(NodeArena& arena, TreeNode*& root, const Object& object);
+
+// Inserts objects in a fixed pseudo-random order, which keeps the tree balanced without sorting.
+// Leaves point into objects, which must outlive the tree.
+TreeNode* InsertionTree(NodeArena& arena, const std::vector<Object>& objects);
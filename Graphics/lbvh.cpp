@@ -0,0 +1,141 @@
+#include "lbvh.h"
+#include "morton.h"
+#include "nodearena.h"
+#include "parallel.h"
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+
+// Length of the common prefix of the keys at i and j, or -1 if j is out of range.
+// Equal codes fall back to comparing indices so every key is unique.
+static int CommonPrefix(const std::vector<uint64_t>& codes, int i, int j) {
+    if (j < 0 || j >= static_cast<int>(codes.size())) return -1;
+
+    uint64_t a = codes[i];
+    uint64_t b = codes[j];
+    if (a == b) {
+        return 64 + std::countl_zero(static_cast<uint32_t>(i ^ j));
+    }
+    return std::countl_zero(a ^ b);
+}
+
+static void MergeChildVolumes(TreeNode* node) {
+    TreeNode* left = node->children[0];
+    TreeNode* right = node->children[1];
+    node->aabbVolume = MergeAABB(left->aabbVolume, right->aabbVolume);
+    node->ritterVolume = MergeBoundingSpheres(left->ritterVolume, right->ritterVolume);
+    node->larssonVolume = MergeBoundingSpheres(left->larssonVolume, right->larssonVolume);
+    node->pcaVolume = MergeBoundingSpheres(left->pcaVolume, right->pcaVolume);
+    node->UpdateChildBounds();
+}
+
+TreeNode* LBVHTree(NodeArena& arena, const std::vector<Object>& objects, int mortonBits) {
+    int n = static_cast<int>(objects.size());
+    if (n == 0) return nullptr;
+
+    // Sort object centers along the Morton curve
+    std::vector<glm::vec3> centers(n);
+    AABB centerBounds;
+    centerBounds.min = glm::vec3(std::numeric_limits<float>::max());
+    centerBounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (int i = 0; i < n; ++i) {
+        centers[i] = (objects[i].boundingBox.min + objects[i].boundingBox.max) * 0.5f;
+        centerBounds.min = glm::min(centerBounds.min, centers[i]);
+        centerBounds.max = glm::max(centerBounds.max, centers[i]);
+    }
+
+    std::vector<uint64_t> codes;
+    ComputeMortonCodes(centers, centerBounds, mortonBits, codes);
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    RadixSortPairs(codes, order, mortonBits > 30 ? 63 : 30);
+
+    // All 2n - 1 nodes in one run: internal nodes first so the root leads, then leaves in Morton order
+    TreeNode* internals = arena.NewArray(2 * static_cast<size_t>(n) - 1);
+    TreeNode* leaves = internals + (n - 1);
+    ParallelFor(0, n, [&](int i) {
+        const Object& obj = objects[order[i]];
+        TreeNode* leaf = &leaves[i];
+        leaf->aabbVolume = obj.boundingBox;
+        leaf->ritterVolume = obj.ritterSphere;
+        leaf->larssonVolume = obj.larssonSphere;
+        leaf->pcaVolume = obj.pcaSphere;
+        leaf->objects = const_cast<Object*>(&obj);
+        leaf->numObjects = 1;
+        });
+    if (n == 1) {
+        return &leaves[0];
+    }
+
+    // Internal node i covers a key range with one end at i; find the other end and the split inside it
+    std::vector<int> leafParents(n);
+    std::vector<int> internalParents(n - 1);
+    internalParents[0] = -1;
+    ParallelFor(0, n - 1, [&](int i) {
+        int d = CommonPrefix(codes, i, i + 1) > CommonPrefix(codes, i, i - 1) ? 1 : -1;
+
+        // Grow the range exponentially, then binary search for its far end
+        int deltaMin = CommonPrefix(codes, i, i - d);
+        int lMax = 2;
+        while (CommonPrefix(codes, i, i + lMax * d) > deltaMin) {
+            lMax *= 2;
+        }
+        int l = 0;
+        for (int t = lMax / 2; t >= 1; t /= 2) {
+            if (CommonPrefix(codes, i, i + (l + t) * d) > deltaMin) {
+                l += t;
+            }
+        }
+        int j = i + l * d;
+
+        // Binary search for the last key sharing more than the range's common prefix
+        int deltaNode = CommonPrefix(codes, i, j);
+        int s = 0;
+        int t = l;
+        do {
+            t = (t + 1) / 2;
+            if (CommonPrefix(codes, i, i + (s + t) * d) > deltaNode) {
+                s += t;
+            }
+        } while (t > 1);
+        int gamma = i + s * d + std::min(d, 0);
+
+        TreeNode* node = &internals[i];
+        node->type = INTERNAL;
+        node->numChildren = 2;
+        node->numObjects = std::abs(j - i) + 1;
+        if (std::min(i, j) == gamma) {
+            node->children[0] = &leaves[gamma];
+            leafParents[gamma] = i;
+        }
+        else {
+            node->children[0] = &internals[gamma];
+            internalParents[gamma] = i;
+        }
+        if (std::max(i, j) == gamma + 1) {
+            node->children[1] = &leaves[gamma + 1];
+            leafParents[gamma + 1] = i;
+        }
+        else {
+            node->children[1] = &internals[gamma + 1];
+            internalParents[gamma + 1] = i;
+        }
+        });
+
+    // Walk up from every leaf; the first child to reach a parent stops, the second merges both
+    std::vector<std::atomic<int>> arrivals(n - 1);
+    ParallelFor(0, n, [&](int i) {
+        int parent = leafParents[i];
+        while (parent >= 0) {
+            if (arrivals[parent].fetch_add(1, std::memory_order_acq_rel) == 0) {
+                return;
+            }
+            MergeChildVolumes(&internals[parent]);
+            parent = internalParents[parent];
+        }
+        });
+
+    return &internals[0];
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+// Linear BVH (Karras 2012): object centers are sorted along a 30- or 63-bit
+// Morton curve, every internal node finds its key range and split independently,
+// and volumes are filled bottom-up by whichever child reaches a parent last.
+// Leaves point into objects, which must outlive the tree.
+TreeNode* LBVHTree(NodeArena& arena, const std::vector<Object>& objects, int mortonBits = 63);
@@ -10,15 +10,24 @@
 #include <vector>
 #include <iostream>
 #include "helper.h"
-#include "OBJ_Loader.h"
+#include "bvh.h"
+#include "blas.h"
+#include "lbvh.h"
+#include "ploc.h"
+#include "aac.h"
+#include "insertion.h"
+#include "flatbvh.h"
+#include "bvhworker.h"
+#include "bvhfile.h"
+#include "raycast.h"
+#include "report.h"
 #include <limits>
+#include <numeric>
 #include <cmath>
 #include <glm/gtx/norm.hpp> // for distance2
 
 
 
-#define MIN_OBJECTS_AT_LEAF 1
-
 GLFWwindow* window;
 
 GLuint shaderProgram;
@@ -48,6 +57,8 @@ float pitch = 0.0f;
 float lastX = 400, lastY = 300;
 float fov = 45.0f;
 bool rightMouseButtonPressed = false;
+bool pickRequested = false; // Left click outside the UI; picked on the next frame
+double pickX = 0.0, pickY = 0.0;
 float cameraSpeed = 2.5f;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
@@ -57,340 +68,29 @@ std::vector<GLuint> VAOs, VBOs, EBOs;
 std::vector<objl::Mesh> meshes;
 std::vector<float> scales;
 
-// Define the AABB structure
-struct AABB {
-    glm::vec3 min;
-    glm::vec3 max;
-};
-
-struct BoundingSphere {
-    glm::vec3 center;
-    float radius;
-};
-
-struct Object {
-    AABB boundingBox;
-    BoundingSphere ritterSphere;
-    BoundingSphere larssonSphere;
-    BoundingSphere pcaSphere;
-    objl::Mesh mesh; // Store the mesh for access to vertices
-};
-
 std::vector<Object> objects;
-enum NodeType { INTERNAL, LEAF };
-
-AABB MergeAABB(const AABB& a, const AABB& b) {
-    AABB result;
-    result.min = glm::min(a.min, b.min);
-    result.max = glm::max(a.max, b.max);
-    return result;
-}
-
-BoundingSphere MergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b) {
-    glm::vec3 d = b.center - a.center;
-    float dist = glm::length(d);
-
-    if (dist + b.radius <= a.radius) {
-        // Sphere b is entirely within sphere a
-        return a;
-    }
 
-    if (dist + a.radius <= b.radius) {
-        // Sphere a is entirely within sphere b
-        return b;
-    }
-
-    // Otherwise, compute the new sphere that minimally bounds both spheres
-    float newRadius = (dist + a.radius + b.radius) * 0.5f;
-    glm::vec3 newCenter = a.center;
-
-    if (dist > 0.0f) {
-        newCenter += d * ((newRadius - a.radius) / dist);
-    }
-
-    return { newCenter, newRadius };
-}
-
-struct TreeNode {
-    NodeType type;
-    AABB aabbVolume;
-    BoundingSphere ritterVolume;
-    BoundingSphere larssonVolume;
-    BoundingSphere pcaVolume;
-
-    Object* objects; // pointer to objects/BVs that the node represents
-    int numObjects; // How many objects in this subtree?
-    TreeNode* lChild;
-    TreeNode* rChild;
-
-    // Constructor for leaf nodes
-    TreeNode() : type(LEAF), objects(nullptr), numObjects(0), lChild(nullptr), rChild(nullptr) {}
-
-    // Constructor for internal nodes
-    TreeNode(TreeNode* left, TreeNode* right) : type(INTERNAL), lChild(left), rChild(right) {
-        // Merge the volumes of left and right children
-        aabbVolume = MergeAABB(left->aabbVolume, right->aabbVolume);
-        ritterVolume = MergeBoundingSpheres(left->ritterVolume, right->ritterVolume);
-        larssonVolume = MergeBoundingSpheres(left->larssonVolume, right->larssonVolume);
-        pcaVolume = MergeBoundingSpheres(left->pcaVolume, right->pcaVolume);
-    }
-};
-
-enum ConstructionMethod {
-    CM_TOP_DOWN,
-    CM_BOTTOM_UP
-};
-
-// Add this enumeration to your global scope
-enum BoundingVolumeType {
-    BVT_NONE,
-    BVT_AABB,
-    BVT_RITTER_SPHERE,
-    BVT_LARSSON_SPHERE,
-    BVT_PCA_SPHERE
-};
-
-struct BoundingVolumeCost {
-    float distance;
-    float combinedVolume;
-    float relativeVolumeIncrease;
-};
-
-enum SplitMethod {
-    SM_MEDIAN_CENTER,
-    SM_MEDIAN_EXTENT,
-    SM_K_EVEN_SPLITS
-};
-
-SplitMethod currentSplitMethod = SM_MEDIAN_CENTER; // Default split method
-int kSplits = 2; // Default number of even splits
+thread_local SplitMethod currentSplitMethod = SM_MEDIAN_CENTER; // Default split method
+thread_local int kSplits = 2; // Default number of even splits
+thread_local AxisMethod currentAxisMethod = AM_ROUND_ROBIN; // Default split axis
+bool collapseWide = false; // Collapse binary top-down trees into BVH_WIDTH-wide nodes
+MergeCostType bottomUpCost = MC_COMBINED; // What the bottom-up builder minimises when merging
+int bottomUpRadius = BOTTOM_UP_SEARCH_RADIUS; // Grid cells on each side the bottom-up builder searches for partners; 0 for exact
+int mortonBits = 63; // Morton code length used by the LBVH builder (30 or 63)
+int plocRadius = PLOC_RADIUS; // Neighbours each PLOC cluster searches on either side
+PLOCDistance plocDistance = PD_SURFACE_AREA; // What the PLOC builder minimises when pairing clusters
+AACMode aacMode = AAC_HIGH_QUALITY; // Bucket size and cluster reduction used by the AAC builder
+bool optimizeTreelets = false; // Run the treelet restructuring pass on every built tree
 
 ConstructionMethod currentMethod = CM_TOP_DOWN;
 BoundingVolumeType currentBVType = BVT_NONE;
 bool displayAllLevels = false;
+bool frustumCulling = true; // Draw only the objects whose boxes are in view
 int currentLevel = 0;
-bool maxHeight = true;
+thread_local bool maxHeight = true;
 int maxHeightValue = 7;
-bool rebuildTree = true;
 bool prevMaxHeight = maxHeight; // Track the previous state of maxHeight checkbox
 
-BoundingSphere ComputeRitterSphere(const std::vector<Object>& objects);
-BoundingSphere ComputeLarssonSphere(const std::vector<Object>& objects);
-BoundingSphere ComputePCASphere(const std::vector<Object>& objects);
-
-float Volume(const AABB& aabb) {
-    glm::vec3 size = aabb.max - aabb.min;
-    return size.x * size.y * size.z;
-}
-
-BoundingVolumeCost CalculateBoundingVolumeCost(const TreeNode* a, const TreeNode* b) {
-    glm::vec3 centerA = (a->aabbVolume.min + a->aabbVolume.max) * 0.5f;
-    glm::vec3 centerB = (b->aabbVolume.min + b->aabbVolume.max) * 0.5f;
-    float distance = glm::distance(centerA, centerB);
-
-    AABB mergedAABB = MergeAABB(a->aabbVolume, b->aabbVolume);
-    float combinedVolume = Volume(mergedAABB);
-
-    float volumeA = Volume(a->aabbVolume);
-    float volumeB = Volume(b->aabbVolume);
-    float relativeVolumeIncrease = (combinedVolume - (volumeA + volumeB)) / (volumeA + volumeB);
-
-    return { distance, combinedVolume, relativeVolumeIncrease };
-}
-
-void FindNodesToMerge(std::vector<TreeNode*>& nodes, TreeNode*& first, TreeNode*& second) {
-    float minCost = std::numeric_limits<float>::max();
-    int firstIndex = -1;
-    int secondIndex = -1;
-
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        for (size_t j = i + 1; j < nodes.size(); ++j) {
-            BoundingVolumeCost cost = CalculateBoundingVolumeCost(nodes[i], nodes[j]);
-
-            // Combine the costs into a single heuristic value
-            float combinedCost = cost.distance + cost.combinedVolume + cost.relativeVolumeIncrease;
-
-            if (combinedCost < minCost) {
-                minCost = combinedCost;
-                firstIndex = i;
-                secondIndex = j;
-            }
-        }
-    }
-
-    first = nodes[firstIndex];
-    second = nodes[secondIndex];
-    nodes.erase(nodes.begin() + secondIndex); // Erase the second node first
-    nodes.erase(nodes.begin() + firstIndex);  // Then erase the first node
-}
-
-TreeNode* BottomUpTree(std::vector<TreeNode*>& nodes) {
-    while (nodes.size() > 1) {
-        TreeNode* first, * second;
-        FindNodesToMerge(nodes, first, second);
-        TreeNode* parent = new TreeNode(first, second);
-        nodes.push_back(parent);
-    }
-    return nodes[0]; // return the root node
-}
-
-AABB ComputeAABB(const std::vector<Object>& objects) {
-    AABB bv;
-    bv.min = glm::vec3(std::numeric_limits<float>::max());
-    bv.max = glm::vec3(std::numeric_limits<float>::lowest());
-
-    for (const auto& obj : objects) {
-        bv.min = glm::min(bv.min, obj.boundingBox.min);
-        bv.max = glm::max(bv.max, obj.boundingBox.max);
-    }
-
-    return bv;
-}
-
-BoundingSphere ComputeBV(const std::vector<Object>& objects, BoundingVolumeType bvType) {
-    switch (bvType) {
-    case BVT_RITTER_SPHERE:
-        return ComputeRitterSphere(objects);
-    case BVT_LARSSON_SPHERE:
-        return ComputeLarssonSphere(objects);
-    case BVT_PCA_SPHERE:
-        return ComputePCASphere(objects);
-    default:
-        throw std::runtime_error("Unknown Bounding Volume Type");
-    }
-}
-
-std::vector<TreeNode*> InitializeLeafNodes(const std::vector<Object>& objects) {
-    std::vector<TreeNode*> nodes;
-    for (const auto& obj : objects) {
-        TreeNode* node = new TreeNode();
-        node->aabbVolume = obj.boundingBox;
-        node->ritterVolume = obj.ritterSphere;
-        node->larssonVolume = obj.larssonSphere;
-        node->pcaVolume = obj.pcaSphere;
-        node->objects = const_cast<Object*>(&obj); // Leaf nodes contain the actual objects
-        node->numObjects = 1;
-        nodes.push_back(node);
-    }
-    return nodes;
-}
-
-int PartitionObjects(std::vector<Object>& objects, int axis, SplitMethod splitMethod, int k = 2) {
-    int numObjects = objects.size();
-    if (numObjects <= 1) {
-        return 0;
-    }
-
-    if (splitMethod == SM_MEDIAN_CENTER) {
-        // Sort objects based on the center of their bounding volumes along the given axis
-        if (axis == 0) {
-            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
-                [](const Object& a, const Object& b) {
-                    return (a.boundingBox.min.x + a.boundingBox.max.x) < (b.boundingBox.min.x + b.boundingBox.max.x);
-                });
-        }
-        else if (axis == 1) {
-            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
-                [](const Object& a, const Object& b) {
-                    return (a.boundingBox.min.y + a.boundingBox.max.y) < (b.boundingBox.min.y + b.boundingBox.max.y);
-                });
-        }
-        else {
-            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
-                [](const Object& a, const Object& b) {
-                    return (a.boundingBox.min.z + a.boundingBox.max.z) < (b.boundingBox.min.z + b.boundingBox.max.z);
-                });
-        }
-        return numObjects / 2;
-    }
-    else if (splitMethod == SM_MEDIAN_EXTENT) {
-        // Sort objects based on the extents of their bounding volumes along the given axis
-        if (axis == 0) {
-            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
-                [](const Object& a, const Object& b) {
-                    return a.boundingBox.max.x < b.boundingBox.max.x;
-                });
-        }
-        else if (axis == 1) {
-            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
-                [](const Object& a, const Object& b) {
-                    return a.boundingBox.max.y < b.boundingBox.max.y;
-                });
-        }
-        else {
-            std::nth_element(objects.begin(), objects.begin() + numObjects / 2, objects.end(),
-                [](const Object& a, const Object& b) {
-                    return a.boundingBox.max.z < b.boundingBox.max.z;
-                });
-        }
-        return numObjects / 2;
-    }
-    else if (splitMethod == SM_K_EVEN_SPLITS) {
-        int k = static_cast<int>(numObjects * 0.7f); // Default is splitRatio = 0.5 for balanced split
-
-        if (axis == 0) {
-            std::nth_element(objects.begin(), objects.begin() + k, objects.end(), [](const Object& a, const Object& b) {
-                return a.boundingBox.min.x < b.boundingBox.min.x;
-                });
-        }
-        else if (axis == 1) {
-            std::nth_element(objects.begin(), objects.begin() + k, objects.end(), [](const Object& a, const Object& b) {
-                return a.boundingBox.min.y < b.boundingBox.min.y;
-                });
-        }
-        else {
-            std::nth_element(objects.begin(), objects.begin() + k, objects.end(), [](const Object& a, const Object& b) {
-                return a.boundingBox.min.z < b.boundingBox.min.z;
-                });
-        }
-
-        return k;
-    }
-
-    return numObjects / 2; // Default split point
-}
-
-void TopDownTree(TreeNode* node, std::vector<Object>& objects, int depth, int maxheightV) {
-    node->aabbVolume = ComputeAABB(objects);
-    node->ritterVolume = ComputeBV(objects, BVT_RITTER_SPHERE);
-    node->larssonVolume = ComputeBV(objects, BVT_LARSSON_SPHERE);
-    node->pcaVolume = ComputeBV(objects, BVT_PCA_SPHERE);
-
-    if (objects.size() <= MIN_OBJECTS_AT_LEAF || (depth >= maxheightV && maxHeight)) {
-        node->type = LEAF;
-        node->objects = objects.data();
-        node->numObjects = objects.size();
-        node->lChild = nullptr;
-        node->rChild = nullptr;
-    }
-    else {
-        node->type = INTERNAL;
-        int axis = depth % 3; // Alternate between x, y, and z axes
-        int medianIndex = PartitionObjects(objects, axis, currentSplitMethod, kSplits);
-
-        node->lChild = new TreeNode();
-        node->rChild = new TreeNode();
-
-        std::vector<Object> leftObjects(objects.begin(), objects.begin() + medianIndex);
-        std::vector<Object> rightObjects(objects.begin() + medianIndex, objects.end());
-
-        TopDownTree(node->lChild, leftObjects, depth + 1, maxheightV);
-        TopDownTree(node->rChild, rightObjects, depth + 1, maxheightV);
-    }
-}
-
-AABB ComputeAABB(const objl::Mesh& mesh) {
-    AABB aabb;
-    aabb.min = glm::vec3(std::numeric_limits<float>::max());
-    aabb.max = glm::vec3(std::numeric_limits<float>::lowest());
-
-    for (const auto& vertex : mesh.Vertices) {
-        aabb.min = glm::min(aabb.min, glm::vec3(vertex.Position.X, vertex.Position.Y, vertex.Position.Z));
-        aabb.max = glm::max(aabb.max, glm::vec3(vertex.Position.X, vertex.Position.Y, vertex.Position.Z));
-    }
-
-    return aabb;
-}
 
 void CreateAABBVertices(const AABB& aabb, std::vector<glm::vec3>& vertices, std::vector<GLuint>& indices) {
     glm::vec3 min = aabb.min;
@@ -443,287 +143,7 @@ void CreateSphereVertices(BoundingSphere sphere, std::vector<glm::vec3>& vertice
     }
 }
 
-BoundingSphere ComputeRitterSphere(const std::vector<Object>& objects) {
-    std::vector<glm::vec3> points;
-    for (const auto& obj : objects) {
-        for (const auto& vertex : obj.mesh.Vertices) {
-            points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
-        }
-    }
-
-    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
-
-    glm::vec3 x = points[0];
-    glm::vec3 y = points[0];
-    float maxDistSq = 0;
-
-    for (const auto& p : points) {
-        float distSq = glm::distance2(p, x);
-        if (distSq > maxDistSq) {
-            y = p;
-            maxDistSq = distSq;
-        }
-    }
-
-    glm::vec3 z = y;
-    maxDistSq = 0;
-    for (const auto& p : points) {
-        float distSq = glm::distance2(p, y);
-        if (distSq > maxDistSq) {
-            z = p;
-            maxDistSq = distSq;
-        }
-    }
-
-    glm::vec3 center = (y + z) * 0.5f;
-    float radius = glm::distance(y, z) * 0.5f;
-
-    for (const auto& p : points) {
-        float dist = glm::distance(center, p);
-        if (dist > radius) {
-            float newRadius = (radius + dist) * 0.5f;
-            float k = (newRadius - radius) / dist;
-            radius = newRadius;
-            center += k * (p - center);
-        }
-    }
-
-    return { center, radius };
-}
-
-BoundingSphere ComputeLarssonSphere(const std::vector<Object>& objects) {
-    std::vector<glm::vec3> points;
-    for (const auto& obj : objects) {
-        for (const auto& vertex : obj.mesh.Vertices) {
-            points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
-        }
-    }
-
-    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
-
-    glm::vec3 minPoint = points[0];
-    glm::vec3 maxPoint = points[0];
-
-    for (const auto& point : points) {
-        minPoint = glm::min(minPoint, point);
-        maxPoint = glm::max(maxPoint, point);
-    }
-
-    glm::vec3 center = (minPoint + maxPoint) * 0.5f;
-    float radius = 0.0f;
-
-    for (const auto& point : points) {
-        float dist = glm::distance(center, point);
-        if (dist > radius) {
-            radius = dist;
-        }
-    }
-
-    for (const auto& point : points) {
-        float dist = glm::distance(center, point);
-        if (dist > radius) {
-            float newRadius = (radius + dist) * 0.5f;
-            float k = (newRadius - radius) / dist;
-            radius = newRadius;
-            center += k * (point - center);
-        }
-    }
-
-    return { center, radius };
-}
-
-BoundingSphere ComputePCASphere(const std::vector<Object>& objects) {
-    std::vector<glm::vec3> points;
-    for (const auto& obj : objects) {
-        for (const auto& vertex : obj.mesh.Vertices) {
-            points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
-        }
-    }
-
-    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
-
-    glm::vec3 mean(0.0f);
-    for (const auto& p : points) {
-        mean += p;
-    }
-    mean /= static_cast<float>(points.size());
-
-    glm::mat3 covariance(0.0f);
-    for (const auto& p : points) {
-        glm::vec3 centered = p - mean;
-        covariance[0][0] += centered.x * centered.x;
-        covariance[0][1] += centered.x * centered.y;
-        covariance[0][2] += centered.x * centered.z;
-        covariance[1][0] += centered.y * centered.x;
-        covariance[1][1] += centered.y * centered.y;
-        covariance[1][2] += centered.y * centered.z;
-        covariance[2][0] += centered.z * centered.x;
-        covariance[2][1] += centered.z * centered.y;
-        covariance[2][2] += centered.z * centered.z;
-    }
-    covariance /= static_cast<float>(points.size());
-
-    glm::vec3 eigenvalues;
-    glm::mat3 eigenvectors;
-    glm::vec3 v(1.0f, 1.0f, 1.0f);
-    for (int i = 0; i < 10; ++i) {
-        v = covariance * v;
-        v = glm::normalize(v);
-    }
-    glm::vec3 principalComponent = v;
-
-    float minProj = std::numeric_limits<float>::max();
-    float maxProj = std::numeric_limits<float>::lowest();
-    for (const auto& p : points) {
-        float proj = glm::dot(p - mean, principalComponent);
-        minProj = std::min(minProj, proj);
-        maxProj = std::max(maxProj, proj);
-    }
-
-    glm::vec3 center = mean + principalComponent * (minProj + maxProj) * 0.5f;
-    float radius = (maxProj - minProj) * 0.5f;
-
-    return { center, radius };
-}
-
-BoundingSphere ComputeRitterSphere(const objl::Mesh& mesh) {
-    std::vector<glm::vec3> points;
-    for (const auto& vertex : mesh.Vertices) {
-        points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
-    }
-
-    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
-
-    glm::vec3 x = points[0];
-    glm::vec3 y = points[0];
-    float maxDistSq = 0;
-
-    for (const auto& p : points) {
-        float distSq = glm::distance2(p, x);
-        if (distSq > maxDistSq) {
-            y = p;
-            maxDistSq = distSq;
-        }
-    }
-
-    glm::vec3 z = y;
-    maxDistSq = 0;
-    for (const auto& p : points) {
-        float distSq = glm::distance2(p, y);
-        if (distSq > maxDistSq) {
-            z = p;
-            maxDistSq = distSq;
-        }
-    }
-
-    glm::vec3 center = (y + z) * 0.5f;
-    float radius = glm::distance(y, z) * 0.5f;
-
-    for (const auto& p : points) {
-        float dist = glm::distance(center, p);
-        if (dist > radius) {
-            float newRadius = (radius + dist) * 0.5f;
-            float k = (newRadius - radius) / dist;
-            radius = newRadius;
-            center += k * (p - center);
-        }
-    }
-
-    return { center, radius };
-}
-
-BoundingSphere ComputeLarssonSphere(const objl::Mesh& mesh) {
-    std::vector<glm::vec3> points;
-    for (const auto& vertex : mesh.Vertices) {
-        points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
-    }
-
-    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
-
-    glm::vec3 minPoint = points[0];
-    glm::vec3 maxPoint = points[0];
-
-    for (const auto& point : points) {
-        minPoint = glm::min(minPoint, point);
-        maxPoint = glm::max(maxPoint, point);
-    }
-
-    glm::vec3 center = (minPoint + maxPoint) * 0.5f;
-    float radius = 0.0f;
-
-    for (const auto& point : points) {
-        float dist = glm::distance(center, point);
-        if (dist > radius) {
-            radius = dist;
-        }
-    }
-
-    for (const auto& point : points) {
-        float dist = glm::distance(center, point);
-        if (dist > radius) {
-            float newRadius = (radius + dist) * 0.5f;
-            float k = (newRadius - radius) / dist;
-            radius = newRadius;
-            center += k * (point - center);
-        }
-    }
-
-    return { center, radius };
-}
-
-BoundingSphere ComputePCASphere(const objl::Mesh& mesh) {
-    std::vector<glm::vec3> points;
-    for (const auto& vertex : mesh.Vertices) {
-        points.emplace_back(vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
-    }
-
-    if (points.empty()) return { glm::vec3(0.0f), 0.0f };
-
-    glm::vec3 mean(0.0f);
-    for (const auto& p : points) {
-        mean += p;
-    }
-    mean /= static_cast<float>(points.size());
-
-    glm::mat3 covariance(0.0f);
-    for (const auto& p : points) {
-        glm::vec3 centered = p - mean;
-        covariance[0][0] += centered.x * centered.x;
-        covariance[0][1] += centered.x * centered.y;
-        covariance[0][2] += centered.x * centered.z;
-        covariance[1][0] += centered.y * centered.x;
-        covariance[1][1] += centered.y * centered.y;
-        covariance[1][2] += centered.y * centered.z;
-        covariance[2][0] += centered.z * centered.x;
-        covariance[2][1] += centered.z * centered.y;
-        covariance[2][2] += centered.z * centered.z;
-    }
-    covariance /= static_cast<float>(points.size());
-
-    glm::vec3 eigenvalues;
-    glm::mat3 eigenvectors;
-    glm::vec3 v(1.0f, 1.0f, 1.0f);
-    for (int i = 0; i < 10; ++i) {
-        v = covariance * v;
-        v = glm::normalize(v);
-    }
-    glm::vec3 principalComponent = v;
-
-    float minProj = std::numeric_limits<float>::max();
-    float maxProj = std::numeric_limits<float>::lowest();
-    for (const auto& p : points) {
-        float proj = glm::dot(p - mean, principalComponent);
-        minProj = std::min(minProj, proj);
-        maxProj = std::max(maxProj, proj);
-    }
-
-    glm::vec3 center = mean + principalComponent * (minProj + maxProj) * 0.5f;
-    float radius = (maxProj - minProj) * 0.5f;
-
-    return { center, radius };
-}
-
-void loadModel(const std::string& path, float scale) {
+void loadModel(const std::string& path, float scale, bool uploadToGPU = true) {
     objl::Loader loader;
     if (loader.LoadFile(path)) {
         for (auto& mesh : loader.LoadedMeshes) {
@@ -736,9 +156,14 @@ void loadModel(const std::string& path, float scale) {
             obj.ritterSphere = ComputeRitterSphere(mesh);
             obj.larssonSphere = ComputeLarssonSphere(mesh);
             obj.pcaSphere = ComputePCASphere(mesh);
+            obj.blas = std::make_shared<BLAS>(BuildBLAS(mesh));
             // Add the object to the vector
             objects.push_back(obj);
 
+            if (!uploadToGPU) {
+                continue; // Headless runs only need the CPU-side objects
+            }
+
             meshes.push_back(mesh);
             unsigned int VAO, VBO, EBO;
 
@@ -771,11 +196,11 @@ void loadModel(const std::string& path, float scale) {
     }
 }
 
-void loadModelsFromDirectory(const std::string& directory, float scale) {
+void loadModelsFromDirectory(const std::string& directory, float scale, bool uploadToGPU = true) {
     for (const auto& entry : std::filesystem::directory_iterator(directory)) {
         if (entry.path().extension() == ".obj") {
             std::cout << "Loading " << entry.path().string() << std::endl;
-            loadModel(entry.path().string(), scale);
+            loadModel(entry.path().string(), scale, uploadToGPU);
         }
     }
 }
@@ -825,6 +250,10 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
             firstMouse = true;
         }
     }
+    else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !ImGui::GetIO().WantCaptureMouse) {
+        glfwGetCursorPos(window, &pickX, &pickY);
+        pickRequested = true;
+    }
 }
 
 void processInput(GLFWwindow* window)
@@ -851,19 +280,8 @@ void processInput(GLFWwindow* window)
         cameraPos -= speed * cameraUp; // Move down
 }
 
-int TreeDepth(TreeNode* node) {
-    if (!node) {
-        return 0;
-    }
-
-    int leftDepth = TreeDepth(node->lChild);
-    int rightDepth = TreeDepth(node->rChild);
-
-    return std::max(leftDepth, rightDepth) + 1;
-}
-
-void DrawBoundingVolumes(TreeNode* node, GLuint bvShaderProgram, bool drawAllLevels, int targetLevel, int currentLevel = 0) {
-    if (!node) return;
+void DrawBoundingVolumes(const FlatBVH& bvh, GLuint bvShaderProgram, bool drawAllLevels, int targetLevel, int node = 0, int currentLevel = 0) {
+    if (node >= bvh.NodeCount()) return;
 
     glm::vec3 color = levelColors[currentLevel % levelColors.size()];
 
@@ -871,7 +289,7 @@ void DrawBoundingVolumes(TreeNode* node, GLuint bvShaderProgram, bool drawAllLev
         if (currentBVType == BVT_AABB) {
             std::vector<glm::vec3> vertices;
             std::vector<GLuint> indices;
-            CreateAABBVertices(node->aabbVolume, vertices, indices);
+            CreateAABBVertices(bvh.aabbVolumes[node], vertices, indices);
 
             GLuint bboxVAO, bboxVBO, bboxEBO;
             glGenVertexArrays(1, &bboxVAO);
@@ -907,7 +325,7 @@ void DrawBoundingVolumes(TreeNode* node, GLuint bvShaderProgram, bool drawAllLev
             std::vector<glm::vec3> vertices;
             std::vector<GLuint> indices;
 
-            CreateSphereVertices(node->ritterVolume, vertices, indices);
+            CreateSphereVertices(bvh.ritterVolumes[node], vertices, indices);
 
             GLuint sphereVAO, sphereVBO, sphereEBO;
             glGenVertexArrays(1, &sphereVAO);
@@ -943,7 +361,7 @@ void DrawBoundingVolumes(TreeNode* node, GLuint bvShaderProgram, bool drawAllLev
             std::vector<glm::vec3> vertices;
             std::vector<GLuint> indices;
 
-            CreateSphereVertices(node->larssonVolume, vertices, indices);
+            CreateSphereVertices(bvh.larssonVolumes[node], vertices, indices);
 
             GLuint sphereVAO, sphereVBO, sphereEBO;
             glGenVertexArrays(1, &sphereVAO);
@@ -979,7 +397,7 @@ void DrawBoundingVolumes(TreeNode* node, GLuint bvShaderProgram, bool drawAllLev
             std::vector<glm::vec3> vertices;
             std::vector<GLuint> indices;
 
-            CreateSphereVertices(node->pcaVolume, vertices, indices);
+            CreateSphereVertices(bvh.pcaVolumes[node], vertices, indices);
 
             GLuint sphereVAO, sphereVBO, sphereEBO;
             glGenVertexArrays(1, &sphereVAO);
@@ -1014,16 +432,63 @@ void DrawBoundingVolumes(TreeNode* node, GLuint bvShaderProgram, bool drawAllLev
     }
 
     // Continue with children if not at target level or drawing all levels
+    // Children follow the node, each starting where the previous child's subtree ends
     if (drawAllLevels || currentLevel != targetLevel) {
-        DrawBoundingVolumes(node->lChild, bvShaderProgram, drawAllLevels, targetLevel, currentLevel + 1);
-        DrawBoundingVolumes(node->rChild, bvShaderProgram, drawAllLevels, targetLevel, currentLevel + 1);
+        int end = SkipIndex(bvh.links[node], node);
+        for (int child = node + 1; child < end; child = SkipIndex(bvh.links[child], child)) {
+            DrawBoundingVolumes(bvh, bvShaderProgram, drawAllLevels, targetLevel, child, currentLevel + 1);
+        }
     }
 }
 
-int main() {
+// Cache key for the tree the current UI settings describe
+BVHConfig CurrentBVHConfig() {
+    BVHConfig config;
+    config.method = currentMethod;
+    config.optimizeTreelets = optimizeTreelets;
+    if (currentMethod == CM_TOP_DOWN) {
+        config.splitMethod = currentSplitMethod;
+        config.axisMethod = currentAxisMethod;
+        config.kSplits = currentSplitMethod == SM_K_EVEN_SPLITS ? kSplits : 2;
+        config.heightCap = maxHeight ? maxHeightValue : INT_MAX;
+        config.collapseWide = BVH_WIDTH > 2 && collapseWide && currentSplitMethod != SM_K_EVEN_SPLITS;
+    }
+    else if (currentMethod == CM_BOTTOM_UP) {
+        config.bottomUpCost = bottomUpCost;
+        config.bottomUpRadius = bottomUpRadius;
+    }
+    else if (currentMethod == CM_LBVH) {
+        config.mortonBits = mortonBits;
+    }
+    else if (currentMethod == CM_PLOC) {
+        config.plocRadius = plocRadius;
+        config.plocDistance = plocDistance;
+    }
+    else if (currentMethod == CM_AAC) {
+        config.aacMode = aacMode;
+    }
+    return config;
+}
+
+int main(int argc, char** argv) {
     const unsigned int SCR_WIDTH = 1920;
     const unsigned int SCR_HEIGHT = 1080;
 
+    // Headless mode: build the trees and print statistics without opening a window
+    if (argc > 1 && std::string(argv[1]) == "--report") {
+        if (argc > 2) {
+            for (int i = 2; i < argc; ++i) {
+                loadModelsFromDirectory(argv[i], 0.0001f, false);
+            }
+        }
+        else {
+            loadModelsFromDirectory("../Assets/power4/part_a", 0.0001f, false);
+            loadModelsFromDirectory("../Assets/power4/part_b", 0.0001f, false);
+        }
+        RunReports(objects);
+        return 0;
+    }
+
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -1066,16 +531,23 @@ int main() {
     loadModelsFromDirectory("../Assets/power6/part_a", 0.0001f);
     loadModelsFromDirectory("../Assets/power6/part_b", 0.0001f);*/
 
-    // Root nodes of the BVH
-    TreeNode* topRoot = new TreeNode();
-    TreeNode* botRoot = nullptr;
-
-    // Build the Top-Down BVH
-    TopDownTree(topRoot, objects, 0, maxHeightValue);
-
-    // Build the Bottom-Up BVH
-    std::vector<TreeNode*> leafNodes = InitializeLeafNodes(objects);
-    botRoot = BottomUpTree(leafNodes);
+    // Every tree built so far, keyed by its settings; start with each construction method's default.
+    // Trees built on an earlier run of the same scene are mapped from their files instead.
+    BVHCache bvhCache;
+    BVHFileStore bvhStore;
+    bvhStore.sceneHash = SceneHash(objects);
+    for (ConstructionMethod method : { CM_BOTTOM_UP, CM_LBVH, CM_PLOC, CM_AAC, CM_INSERTION, CM_TOP_DOWN }) {
+        currentMethod = method;
+        bvhCache.Insert(CurrentBVHConfig(), LoadOrBuildBVH(bvhStore, CurrentBVHConfig(), objects));
+    }
+    const CachedBVH* currentBVH = bvhCache.Find(CurrentBVHConfig());
+    BVHBuildWorker buildWorker(objects, bvhStore);
+    bool picked = false;
+    RayHit pickedHit;
+    std::string pickedName;
+    std::vector<int> drawList;   // Scene objects drawn this frame
+    int cullNodesTested = 0;
+    double cullMs = 0.0;
 
     // Enable depth test
     glEnable(GL_DEPTH_TEST);
@@ -1100,7 +572,7 @@ int main() {
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        int maxD = (currentMethod == CM_TOP_DOWN) ? TreeDepth(topRoot) : TreeDepth(botRoot);
+        int maxD = currentBVH->flat.depth;
 
         // ImGui interface
         ImGui::Begin("Bounding Volume");
@@ -1113,18 +585,82 @@ int main() {
         if (ImGui::RadioButton("Bottom-Up", currentMethod == CM_BOTTOM_UP)) {
             currentMethod = CM_BOTTOM_UP;
         }
+        if (ImGui::RadioButton("LBVH", currentMethod == CM_LBVH)) {
+            currentMethod = CM_LBVH;
+        }
+        if (ImGui::RadioButton("PLOC", currentMethod == CM_PLOC)) {
+            currentMethod = CM_PLOC;
+        }
+        if (ImGui::RadioButton("AAC", currentMethod == CM_AAC)) {
+            currentMethod = CM_AAC;
+        }
+        if (ImGui::RadioButton("Insertion", currentMethod == CM_INSERTION)) {
+            currentMethod = CM_INSERTION;
+        }
+
+        ImGui::Checkbox("Optimize Treelets", &optimizeTreelets);
 
         if (currentMethod == CM_TOP_DOWN) {
-            if (ImGui::Checkbox("Restrict Height to 7", &maxHeight)) {
-                rebuildTree = true; // Set rebuild flag if checkbox state changes
-                maxHeightValue = maxHeight ? 7 : INT_MAX;
-            }
+            ImGui::Checkbox("Restrict Height to 7", &maxHeight);
             ImGui::Text("Split Method:");
-            const char* splitItems[] = { "Median of Centers", "Median of Extents", "K Even Splits" };
+            const char* splitItems[] = { "Median of Centers", "Median of Extents", "K Even Splits", "Surface Area Heuristic" };
             static int splitItem = 0; // Default to "Median of Centers"
             if (ImGui::Combo("##SplitMethod", &splitItem, splitItems, IM_ARRAYSIZE(splitItems))) {
                 currentSplitMethod = static_cast<SplitMethod>(splitItem);
-                rebuildTree = true; // Set rebuild flag
+            }
+            ImGui::Text("Split Axis:");
+            const char* axisItems[] = { "Round Robin", "Longest Extent", "Max Variance", "Best Cost" };
+            static int axisItem = 0; // Default to "Round Robin"
+            if (ImGui::Combo("##AxisMethod", &axisItem, axisItems, IM_ARRAYSIZE(axisItems))) {
+                currentAxisMethod = static_cast<AxisMethod>(axisItem);
+            }
+            if (currentSplitMethod == SM_K_EVEN_SPLITS) {
+                ImGui::SliderInt("K", &kSplits, 2, BVH_WIDTH);
+            }
+            else if (BVH_WIDTH > 2) {
+                ImGui::Checkbox("Collapse to Wide Nodes", &collapseWide);
+            }
+        }
+
+        if (currentMethod == CM_BOTTOM_UP) {
+            ImGui::Text("Merge Cost:");
+            const char* costItems[] = { "Distance + Volume + Increase", "Surface Area", "Volume" };
+            static int costItem = 0; // Default to the combined heuristic
+            if (ImGui::Combo("##MergeCost", &costItem, costItems, IM_ARRAYSIZE(costItems))) {
+                bottomUpCost = static_cast<MergeCostType>(costItem);
+            }
+            ImGui::SliderInt("Partner Search Radius", &bottomUpRadius, 0, 16, bottomUpRadius == 0 ? "Exact" : "%d");
+        }
+
+        if (currentMethod == CM_LBVH) {
+            ImGui::Text("Morton Code Bits:");
+            if (ImGui::RadioButton("30", mortonBits == 30)) {
+                mortonBits = 30;
+            }
+            ImGui::SameLine();
+            if (ImGui::RadioButton("63", mortonBits == 63)) {
+                mortonBits = 63;
+            }
+        }
+
+        if (currentMethod == CM_PLOC) {
+            ImGui::SliderInt("Search Radius", &plocRadius, 1, 64);
+            ImGui::Text("Merge Distance:");
+            const char* distanceItems[] = { "Surface Area", "Bounding Volume Cost" };
+            static int distanceItem = 0; // Default to "Surface Area"
+            if (ImGui::Combo("##PLOCDistance", &distanceItem, distanceItems, IM_ARRAYSIZE(distanceItems))) {
+                plocDistance = static_cast<PLOCDistance>(distanceItem);
+            }
+        }
+
+        if (currentMethod == CM_AAC) {
+            ImGui::Text("AAC Mode:");
+            if (ImGui::RadioButton("Fast", aacMode == AAC_FAST)) {
+                aacMode = AAC_FAST;
+            }
+            ImGui::SameLine();
+            if (ImGui::RadioButton("High Quality", aacMode == AAC_HIGH_QUALITY)) {
+                aacMode = AAC_HIGH_QUALITY;
             }
         }
 
@@ -1140,6 +676,21 @@ int main() {
 
         // Slider for selecting tree level
         ImGui::SliderInt("Tree Level", &currentLevel, 0, maxD - 1);
+        ImGui::Text("Cached Trees: %zu (%.1f MB)", bvhCache.Size(), bvhCache.Bytes() / (1024.0 * 1024.0));
+        if (buildWorker.Busy()) {
+            ImGui::Text("Building...");
+        }
+        ImGui::Checkbox("Frustum Culling", &frustumCulling);
+        ImGui::Text("Drawn: %zu of %zu objects", drawList.size(), VAOs.size());
+        if (frustumCulling) {
+            ImGui::Text("Culling: %d nodes tested in %.2f ms", cullNodesTested, cullMs);
+        }
+        if (picked) {
+            ImGui::Text("Picked: %s, triangle %d at %.1f", pickedName.c_str(), pickedHit.triangle, pickedHit.t);
+        }
+        else {
+            ImGui::Text("Left click to pick an object");
+        }
 
         ImGui::End();
 
@@ -1147,12 +698,17 @@ int main() {
         // Clear screen
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Rebuild the tree if needed
-        if (rebuildTree) {
-            delete topRoot;
-            topRoot = new TreeNode();
-            TopDownTree(topRoot, objects, 0, maxHeightValue);
-            rebuildTree = false; // Reset the rebuild flag
+        // Cache whatever the background worker finished, then swap in the tree for the current
+        // settings. Until it exists the previous tree keeps being drawn, so it must not be evicted.
+        if (std::unique_ptr<BVHBuildResult> result = buildWorker.TakeResult()) {
+            bvhCache.Insert(result->config, std::move(result->bvh), currentBVH);
+        }
+        BVHConfig wantedConfig = CurrentBVHConfig();
+        if (const CachedBVH* cached = bvhCache.Find(wantedConfig)) {
+            currentBVH = cached;
+        }
+        else {
+            buildWorker.Request(wantedConfig);
         }
 
         // Use shader program
@@ -1174,8 +730,39 @@ int main() {
         glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
         glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 0.537, 0.098, 0.898);
 
-        // Draw each loaded model with its corresponding scale
-        for (size_t i = 0; i < VAOs.size(); ++i) {
+        // Cast a ray through the clicked pixel, in the unscaled space the trees are built in
+        if (pickRequested) {
+            pickRequested = false;
+            int windowWidth, windowHeight;
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            glm::vec2 ndc(2.0f * pickX / windowWidth - 1.0f, 1.0f - 2.0f * pickY / windowHeight);
+            glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.0001f, 0.0001f, 0.0001f));
+            glm::mat4 unproject = glm::inverse(projection * view * model);
+            glm::vec4 nearPoint = unproject * glm::vec4(ndc, -1.0f, 1.0f);
+            glm::vec4 farPoint = unproject * glm::vec4(ndc, 1.0f, 1.0f);
+            glm::vec3 start = glm::vec3(nearPoint) / nearPoint.w;
+            Ray ray = { start, glm::normalize(glm::vec3(farPoint) / farPoint.w - start) };
+            picked = RayCast(currentBVH->flat, ray, std::numeric_limits<float>::max(), pickedHit, currentBVType);
+            if (picked) {
+                pickedName = pickedHit.object->mesh.MeshName; // The hit's object may be evicted with its tree
+            }
+        }
+
+        // Walk the tree for the objects in view, in the unscaled space it is built in
+        drawList.clear();
+        if (frustumCulling) {
+            double cullStart = glfwGetTime();
+            glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.0001f, 0.0001f, 0.0001f));
+            cullNodesTested = FlatFrustumCull(currentBVH->flat, ExtractFrustum(projection * view * model), drawList);
+            cullMs = (glfwGetTime() - cullStart) * 1000.0;
+        }
+        else {
+            drawList.resize(VAOs.size());
+            std::iota(drawList.begin(), drawList.end(), 0);
+        }
+
+        // Draw each visible model with its corresponding scale
+        for (int i : drawList) {
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::scale(model, glm::vec3(scales[i], scales[i], scales[i]));
             int modelLoc = glGetUniformLocation(shaderProgram, "model");
@@ -1200,8 +787,7 @@ int main() {
         glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
         // Draw bounding volumes based on the selected type and level
-        TreeNode* rootToDraw = (currentMethod == CM_TOP_DOWN) ? topRoot : botRoot;
-        DrawBoundingVolumes(rootToDraw, bvShaderProgram, displayAllLevels, currentLevel);
+        DrawBoundingVolumes(currentBVH->flat, bvShaderProgram, displayAllLevels, currentLevel);
 
         // Render ImGui
         ImGui::Render();
@@ -0,0 +1,59 @@
+#include "morton.h"
+#include "parallel.h"
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+void ComputeMortonCodes(std::span<const glm::vec3> points, const AABB& bounds, int codeBits, std::vector<uint64_t>& codes) {
+    codes.resize(points.size());
+    glm::vec3 extent = bounds.max - bounds.min;
+    glm::vec3 invExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    ParallelFor(0, static_cast<int>(points.size()), [&](int i) {
+        glm::vec3 p = (points[i] - bounds.min) * invExtent;
+        codes[i] = codeBits > 30 ? MortonCode63(p) : MortonCode30(p);
+        });
+}
+
+void RadixSortPairs(std::vector<uint64_t>& keys, std::vector<int>& values, int keyBits) {
+    int n = static_cast<int>(keys.size());
+    if (n <= 1) return;
+
+    int numChunks = std::min(NumWorkerThreads(), std::max(1, n / 4096));
+    std::vector<uint64_t> keysTmp(n);
+    std::vector<int> valuesTmp(n);
+    std::vector<int> histograms(numChunks * RADIX_BUCKETS);
+
+    for (int shift = 0; shift < keyBits; shift += RADIX_BITS) {
+        // Each chunk counts its own digits...
+        std::fill(histograms.begin(), histograms.end(), 0);
+        ParallelForChunks(0, n, numChunks, [&](int begin, int end, int chunk) {
+            int* histogram = &histograms[chunk * RADIX_BUCKETS];
+            for (int i = begin; i < end; ++i) {
+                histogram[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+            });
+
+        // ...then the counts become per-chunk output offsets, digit-major so the sort stays stable
+        int offset = 0;
+        for (int digit = 0; digit < RADIX_BUCKETS; ++digit) {
+            for (int chunk = 0; chunk < numChunks; ++chunk) {
+                int count = histograms[chunk * RADIX_BUCKETS + digit];
+                histograms[chunk * RADIX_BUCKETS + digit] = offset;
+                offset += count;
+            }
+        }
+
+        ParallelForChunks(0, n, numChunks, [&](int begin, int end, int chunk) {
+            int* offsets = &histograms[chunk * RADIX_BUCKETS];
+            for (int i = begin; i < end; ++i) {
+                int dst = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                keysTmp[dst] = keys[i];
+                valuesTmp[dst] = values[i];
+            }
+            });
+
+        keys.swap(keysTmp);
+        values.swap(valuesTmp);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "classes.h"
+
+// Spread the low 10 bits of v so two zero bits separate each one
+inline uint32_t ExpandBits10(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// Spread the low 21 bits of v so two zero bits separate each one
+inline uint64_t ExpandBits21(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | (v << 32)) & 0x001f00000000ffffull;
+    v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+    v = (v | (v << 8)) & 0x100f00f00f00f00full;
+    v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+// 30-bit Morton code of a point normalised to [0, 1]^3
+inline uint64_t MortonCode30(const glm::vec3& p) {
+    glm::vec3 q = glm::clamp(p * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+    return (ExpandBits10(static_cast<uint32_t>(q.x)) << 2) | (ExpandBits10(static_cast<uint32_t>(q.y)) << 1) | ExpandBits10(static_cast<uint32_t>(q.z));
+}
+
+// 63-bit Morton code of a point normalised to [0, 1]^3
+inline uint64_t MortonCode63(const glm::vec3& p) {
+    glm::vec3 q = glm::clamp(p * 2097152.0f, glm::vec3(0.0f), glm::vec3(2097151.0f));
+    return (ExpandBits21(static_cast<uint64_t>(q.x)) << 2) | (ExpandBits21(static_cast<uint64_t>(q.y)) << 1) | ExpandBits21(static_cast<uint64_t>(q.z));
+}
+
+// Quantise points inside bounds to 30- or 63-bit Morton codes, in parallel
+void ComputeMortonCodes(std::span<const glm::vec3> points, const AABB& bounds, int codeBits, std::vector<uint64_t>& codes);
+
+// Stable parallel LSD radix sort of keys (using their low keyBits bits), carrying values along
+void RadixSortPairs(std::vector<uint64_t>& keys, std::vector<int>& values, int keyBits);
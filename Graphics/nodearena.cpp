@@ -0,0 +1,53 @@
+#include "nodearena.h"
+#include <algorithm>
+#include <new>
+
+NodeArena::NodeArena(NodeArena&& other) noexcept
+    : blocks(std::move(other.blocks)), used(other.used), nodeCount(other.nodeCount), capacity(other.capacity) {
+    other.blocks.clear();
+    other.used = other.nodeCount = other.capacity = 0;
+}
+
+NodeArena& NodeArena::operator=(NodeArena&& other) noexcept {
+    if (this != &other) {
+        Release();
+        blocks = std::move(other.blocks);
+        used = other.used;
+        nodeCount = other.nodeCount;
+        capacity = other.capacity;
+        other.blocks.clear();
+        other.used = other.nodeCount = other.capacity = 0;
+    }
+    return *this;
+}
+
+TreeNode* NodeArena::Allocate(size_t count) {
+    if (blocks.empty() || used + count > blocks.back().capacity) {
+        size_t blockNodes = std::max({ count, static_cast<size_t>(NODE_ARENA_FIRST_BLOCK), capacity });
+        void* memory = ::operator new(blockNodes * sizeof(TreeNode), std::align_val_t(alignof(TreeNode)));
+        blocks.push_back({ static_cast<TreeNode*>(memory), blockNodes });
+        capacity += blockNodes;
+        used = 0;
+    }
+
+    TreeNode* nodes = blocks.back().nodes + used;
+    used += count;
+    nodeCount += count;
+    return nodes;
+}
+
+TreeNode* NodeArena::NewArray(size_t count) {
+    TreeNode* nodes = Allocate(count);
+    for (size_t i = 0; i < count; ++i) {
+        new (nodes + i) TreeNode();
+    }
+    return nodes;
+}
+
+void NodeArena::Release() {
+    for (const Block& block : blocks) {
+        ::operator delete(block.nodes, std::align_val_t(alignof(TreeNode)));
+    }
+    blocks.clear();
+    used = nodeCount = capacity = 0;
+}
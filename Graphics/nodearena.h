@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "bvh.h"
+
+// Nodes in the first block; every further block doubles the arena's capacity
+#define NODE_ARENA_FIRST_BLOCK 1024
+
+static_assert(std::is_trivially_destructible_v<TreeNode>, "Arena nodes are released without running destructors");
+
+// Monotonic allocator for the nodes of one tree. Nodes are carved from contiguous
+// blocks aligned to alignof(TreeNode) (a cache line) and are never freed one at a
+// time; Release frees the whole tree in one pass over its few blocks.
+class NodeArena {
+public:
+    NodeArena() = default;
+    ~NodeArena() { Release(); }
+    NodeArena(NodeArena&& other) noexcept;
+    NodeArena& operator=(NodeArena&& other) noexcept;
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    template <typename... Args>
+    TreeNode* New(Args&&... args) {
+        return new (Allocate(1)) TreeNode(std::forward<Args>(args)...);
+    }
+
+    // count default-constructed nodes, contiguous in memory
+    TreeNode* NewArray(size_t count);
+
+    void Release();
+
+    size_t NodeCount() const { return nodeCount; }
+    size_t Bytes() const { return capacity * sizeof(TreeNode); }
+
+private:
+    struct Block {
+        TreeNode* nodes;
+        size_t capacity;
+    };
+
+    TreeNode* Allocate(size_t count);
+
+    std::vector<Block> blocks;
+    size_t used = 0;       // Nodes taken from the last block
+    size_t nodeCount = 0;
+    size_t capacity = 0;   // Nodes across all blocks
+};
@@ -0,0 +1,295 @@
+#include "nodeorder.h"
+#include <algorithm>
+#include <deque>
+
+// Sibling groups are named by their parent's index in the flat tree; the root's group is -1
+static const int ROOT_GROUP = -1;
+
+static void GroupMembers(const FlatBVH& flat, int group, std::vector<int>& members) {
+    members.clear();
+    if (group == ROOT_GROUP) {
+        members.push_back(0);
+        return;
+    }
+    for (int child = group + 1; child < flat.links[group].skipOrFirst; child = SkipIndex(flat.links[child], child)) {
+        members.push_back(child);
+    }
+}
+
+// Groups below group, in member order
+static void ChildGroups(const FlatBVH& flat, int group, std::vector<int>& children) {
+    std::vector<int> members;
+    GroupMembers(flat, group, members);
+    children.clear();
+    for (int member : members) {
+        if (flat.links[member].count == 0) children.push_back(member);
+    }
+}
+
+// Builds the placement of every group, numbering each group's members consecutively
+class GroupPlacer {
+public:
+    explicit GroupPlacer(const FlatBVH& flat) : flat(flat), newIndex(flat.NodeCount(), -1) {}
+
+    void Place(int group) {
+        GroupMembers(flat, group, members);
+        for (int member : members) {
+            newIndex[member] = next++;
+        }
+    }
+
+    void DepthFirst() {
+        std::vector<int> stack = { ROOT_GROUP };
+        std::vector<int> children;
+        while (!stack.empty()) {
+            int group = stack.back();
+            stack.pop_back();
+            Place(group);
+            ChildGroups(flat, group, children);
+            stack.insert(stack.end(), children.rbegin(), children.rend());
+        }
+    }
+
+    void BreadthFirst() {
+        std::deque<int> queue = { ROOT_GROUP };
+        std::vector<int> children;
+        while (!queue.empty()) {
+            int group = queue.front();
+            queue.pop_front();
+            Place(group);
+            ChildGroups(flat, group, children);
+            queue.insert(queue.end(), children.begin(), children.end());
+        }
+    }
+
+    // Places the groups within levels of group: the top half of the levels, then every
+    // subtree hanging below them, each laid out the same way
+    void VanEmdeBoas(int group, int levels) {
+        levels = std::min(levels, GroupLevels(group));
+        if (levels <= 1) {
+            Place(group);
+            return;
+        }
+
+        int topLevels = levels / 2;
+        VanEmdeBoas(group, topLevels);
+
+        std::vector<int> frontier = { group }, next, children;
+        for (int level = 0; level < topLevels; ++level) {
+            next.clear();
+            for (int g : frontier) {
+                ChildGroups(flat, g, children);
+                next.insert(next.end(), children.begin(), children.end());
+            }
+            frontier.swap(next);
+        }
+        for (int bottom : frontier) {
+            VanEmdeBoas(bottom, levels - topLevels);
+        }
+    }
+
+    // Levels of groups from group down to its deepest leaf
+    int GroupLevels(int group) {
+        if (groupLevels.empty()) {
+            // Children follow their parent, so a backwards pass sees every child group first
+            groupLevels.assign(flat.NodeCount(), 0);
+            for (int i = flat.NodeCount() - 1; i >= 0; --i) {
+                if (flat.links[i].count > 0) continue;
+                int levels = 0;
+                for (int child = i + 1; child < flat.links[i].skipOrFirst; child = SkipIndex(flat.links[child], child)) {
+                    levels = std::max(levels, groupLevels[child]);
+                }
+                groupLevels[i] = levels + 1;
+            }
+        }
+        return group == ROOT_GROUP ? groupLevels[0] + 1 : groupLevels[group];
+    }
+
+    const FlatBVH& flat;
+    std::vector<int> groupLevels; // Per internal node, the levels of the group of its children
+    std::vector<int> newIndex;
+    std::vector<int> members;
+    int next = 0;
+};
+
+OrderedBVH OrderNodes(const FlatBVH& flat, NodeOrder order) {
+    OrderedBVH bvh;
+    bvh.objects = flat.objects;
+    bvh.depth = flat.depth;
+    bvh.stackSize = flat.stackSize;
+    bvh.order = order;
+    bvh.primitives.assign(flat.primitives.begin(), flat.primitives.end());
+    int numNodes = flat.NodeCount();
+    if (numNodes == 0) return bvh;
+
+    GroupPlacer placer(flat);
+    switch (order) {
+    case NO_BREADTH_FIRST:
+        placer.BreadthFirst();
+        break;
+    case NO_VAN_EMDE_BOAS:
+        placer.VanEmdeBoas(ROOT_GROUP, flat.depth);
+        break;
+    default:
+        placer.DepthFirst();
+        break;
+    }
+
+    bvh.links.resize(numNodes);
+    bvh.aabbVolumes.resize(numNodes);
+    for (int i = 0; i < numNodes; ++i) {
+        int index = placer.newIndex[i];
+        const FlatLink& link = flat.links[i];
+        if (link.count > 0) {
+            bvh.links[index] = { link.skipOrFirst, link.count };
+        }
+        else {
+            int numChildren = 0;
+            for (int child = i + 1; child < link.skipOrFirst; child = SkipIndex(flat.links[child], child)) {
+                numChildren++;
+            }
+            bvh.links[index] = { placer.newIndex[i + 1], -numChildren };
+        }
+        bvh.aabbVolumes[index] = flat.aabbVolumes[i];
+    }
+    return bvh;
+}
+
+// Visits every node whose parent passed test, first child first, handing leaves that
+// pass to onLeaf
+template <typename Test, typename OnLeaf>
+static void Traverse(const OrderedBVH& bvh, Test test, OnLeaf onLeaf) {
+    if (bvh.links.empty()) return;
+
+    int localStack[ORDERED_STACK_SIZE];
+    std::vector<int> heapStack;
+    int* stack = localStack;
+    if (bvh.stackSize > ORDERED_STACK_SIZE) {
+        heapStack.resize(bvh.stackSize);
+        stack = heapStack.data();
+    }
+
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        int node = stack[--top];
+        if (!test(node)) continue;
+
+        const OrderedLink& link = bvh.links[node];
+        if (link.count > 0) {
+            onLeaf(link);
+            continue;
+        }
+        for (int child = link.first - link.count - 1; child >= link.first; --child) {
+            stack[top++] = child;
+        }
+    }
+}
+
+bool OrderedRayCast(const OrderedBVH& bvh, const Ray& ray, float tMax, RayHit& hit) {
+    glm::vec3 invDir = 1.0f / ray.direction;
+    bool found = false;
+    Traverse(bvh,
+        [&](int node) {
+            float tEntry;
+            return RayIntersectsAABB(ray, invDir, bvh.aabbVolumes[node], tMax, tEntry);
+        },
+        [&](const OrderedLink& link) {
+            for (int p = link.first; p < link.first + link.count; ++p) {
+                const Object& obj = bvh.objects[bvh.primitives[p]];
+                int triangle;
+                float u, v;
+                if (obj.blas && BLASRayCast(*obj.blas, ray, tMax, triangle, u, v)) {
+                    hit = { &obj, triangle, tMax, u, v };
+                    found = true;
+                }
+            }
+        });
+    return found;
+}
+
+void OrderedOverlap(const OrderedBVH& bvh, const AABB& box, std::vector<const Object*>& results) {
+    Traverse(bvh,
+        [&](int node) { return AABBOverlap(bvh.aabbVolumes[node], box); },
+        [&](const OrderedLink& link) {
+            for (int p = link.first; p < link.first + link.count; ++p) {
+                const Object& obj = bvh.objects[bvh.primitives[p]];
+                if (AABBOverlap(obj.boundingBox, box) && obj.blas && BLASOverlaps(*obj.blas, box)) {
+                    results.push_back(&obj);
+                }
+            }
+        });
+}
+
+CacheModel::CacheModel() : tags(CACHE_MODEL_BYTES / CACHE_MODEL_LINE, 0) {}
+
+void CacheModel::Read(const void* address, size_t bytes) {
+    const size_t numSets = CACHE_MODEL_BYTES / (CACHE_MODEL_LINE * CACHE_MODEL_WAYS);
+    uintptr_t first = reinterpret_cast<uintptr_t>(address) / CACHE_MODEL_LINE;
+    uintptr_t last = (reinterpret_cast<uintptr_t>(address) + bytes - 1) / CACHE_MODEL_LINE;
+    for (uintptr_t line = first; line <= last; ++line) {
+        accesses++;
+        uintptr_t* set = tags.data() + (line % numSets) * CACHE_MODEL_WAYS;
+        uintptr_t* end = set + CACHE_MODEL_WAYS;
+        uintptr_t* way = std::find(set, end, line);
+        if (way == end) {
+            misses++;
+            way = end - 1; // The least recently used line is evicted
+        }
+        std::copy_backward(set, way, way + 1);
+        set[0] = line;
+    }
+}
+
+void CacheModel::Clear() {
+    std::fill(tags.begin(), tags.end(), 0);
+    accesses = 0;
+    misses = 0;
+}
+
+// Both layouts read a node's link and its box
+static void ReadNode(const OrderedBVH& bvh, int node, CacheModel& cache) {
+    cache.Read(&bvh.links[node], sizeof(OrderedLink));
+    cache.Read(&bvh.aabbVolumes[node], sizeof(AABB));
+}
+
+static void ReadNode(const FlatBVH& bvh, int node, CacheModel& cache) {
+    cache.Read(&bvh.links[node], sizeof(FlatLink));
+    cache.Read(&bvh.aabbVolumes[node], sizeof(AABB));
+}
+
+void ModelRayTraversal(const FlatBVH& bvh, const Ray& ray, float tMax, CacheModel& cache) {
+    glm::vec3 invDir = 1.0f / ray.direction;
+    for (int i = 0; i < bvh.NodeCount();) {
+        ReadNode(bvh, i, cache);
+        float tEntry;
+        i = RayIntersectsAABB(ray, invDir, bvh.aabbVolumes[i], tMax, tEntry) ? i + 1 : SkipIndex(bvh.links[i], i);
+    }
+}
+
+void ModelRayTraversal(const OrderedBVH& bvh, const Ray& ray, float tMax, CacheModel& cache) {
+    glm::vec3 invDir = 1.0f / ray.direction;
+    Traverse(bvh,
+        [&](int node) {
+            ReadNode(bvh, node, cache);
+            float tEntry;
+            return RayIntersectsAABB(ray, invDir, bvh.aabbVolumes[node], tMax, tEntry);
+        },
+        [](const OrderedLink&) {});
+}
+
+void ModelOverlapTraversal(const FlatBVH& bvh, const AABB& box, CacheModel& cache) {
+    for (int i = 0; i < bvh.NodeCount();) {
+        ReadNode(bvh, i, cache);
+        i = AABBOverlap(bvh.aabbVolumes[i], box) ? i + 1 : SkipIndex(bvh.links[i], i);
+    }
+}
+
+void ModelOverlapTraversal(const OrderedBVH& bvh, const AABB& box, CacheModel& cache) {
+    Traverse(bvh,
+        [&](int node) {
+            ReadNode(bvh, node, cache);
+            return AABBOverlap(bvh.aabbVolumes[node], box);
+        },
+        [](const OrderedLink&) {});
+}
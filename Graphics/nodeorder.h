@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "bvh.h"
+#include "blas.h"
+#include "flatbvh.h"
+
+// Entries a query's traversal stack holds before it moves to the heap
+#define ORDERED_STACK_SIZE 256
+// Data cache modelled when counting a traversal's misses: 32 KB, 8-way, 64-byte lines
+#define CACHE_MODEL_BYTES (32 * 1024)
+#define CACHE_MODEL_WAYS 8
+#define CACHE_MODEL_LINE 64
+
+// How an ordered tree lays out its nodes. Every order keeps the children of a node next
+// to each other; it is these sibling groups that are placed.
+enum NodeOrder {
+    NO_DEPTH_FIRST,   // Each group followed by its descendants' groups, subtree by subtree
+    NO_BREADTH_FIRST, // Level by level
+    NO_VAN_EMDE_BOAS  // Top half of the levels first, then each bottom subtree, recursively
+};
+
+// Leaves: first entry in primitives and their object count. Internal nodes: first child
+// and the number of children, negated.
+struct OrderedLink {
+    int first;
+    int count;
+};
+
+// AABB tree flattened in a chosen node order and walked with a stack, since only
+// depth-first order lets a FlatBVH skip a subtree by jumping ahead
+struct OrderedBVH {
+    std::vector<OrderedLink> links;
+    std::vector<AABB> aabbVolumes;
+    std::vector<int> primitives;     // Objects of each leaf, as indices into objects
+    const Object* objects = nullptr;
+    int depth = 0;
+    int stackSize = 0; // As FlatBVH::stackSize; reordering keeps every node's children
+    NodeOrder order = NO_DEPTH_FIRST;
+
+    int NodeCount() const { return static_cast<int>(links.size()); }
+};
+
+// Reorders flat's nodes; the leaves keep their primitives
+OrderedBVH OrderNodes(const FlatBVH& flat, NodeOrder order);
+
+// Same queries as FlatRayCast and FlatOverlap
+bool OrderedRayCast(const OrderedBVH& bvh, const Ray& ray, float tMax, RayHit& hit);
+void OrderedOverlap(const OrderedBVH& bvh, const AABB& box, std::vector<const Object*>& results);
+
+// Set-associative LRU model of a data cache, fed the addresses a traversal reads
+class CacheModel {
+public:
+    CacheModel();
+    void Read(const void* address, size_t bytes);
+    void Clear();
+
+    long long Accesses() const { return accesses; }
+    long long Misses() const { return misses; }
+
+private:
+    std::vector<uintptr_t> tags; // CACHE_MODEL_WAYS per set, most recently used first; 0 when empty
+    long long accesses = 0;
+    long long misses = 0;
+};
+
+// Feed cache the node reads of a ray or box query, without testing any objects
+void ModelRayTraversal(const FlatBVH& bvh, const Ray& ray, float tMax, CacheModel& cache);
+void ModelRayTraversal(const OrderedBVH& bvh, const Ray& ray, float tMax, CacheModel& cache);
+void ModelOverlapTraversal(const FlatBVH& bvh, const AABB& box, CacheModel& cache);
+void ModelOverlapTraversal(const OrderedBVH& bvh, const AABB& box, CacheModel& cache);
@@ -0,0 +1,177 @@
+#include "packet.h"
+#include "raycast.h"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <vector>
+#include <emmintrin.h>
+
+struct PacketStackEntry {
+    __m128 tEntry; // Where each ray enters the node
+    int node;
+    int mask;      // Rays that enter the node
+};
+
+// The rays of one packet in SoA layout
+struct RayPacket {
+    __m128 start[3];
+    __m128 invDir[3];
+    alignas(16) float tMax[RAY_PACKET_SIZE];
+    const Ray* rays[RAY_PACKET_SIZE];
+    RayHit* hits[RAY_PACKET_SIZE];
+};
+
+// Slab test of one box against every ray; bit i of the result is set when ray i enters it
+static int PacketEntersBox(const RayPacket& packet, const AABB& box, __m128 tMax, __m128& tEntry) {
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = tMax;
+    for (int axis = 0; axis < 3; ++axis) {
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.min[axis]), packet.start[axis]), packet.invDir[axis]);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.max[axis]), packet.start[axis]), packet.invDir[axis]);
+        tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+        tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+    }
+    tEntry = tNear;
+    return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+}
+
+// Closest hits among a leaf's objects for the rays in mask
+static void PacketLeaf(const FlatBVH& bvh, const FlatLink& link, RayPacket& packet, int mask) {
+    for (int p = link.skipOrFirst; p < link.skipOrFirst + link.count; ++p) {
+        const Object& obj = bvh.objects[bvh.primitives[p]];
+        if (!obj.blas) continue;
+
+        for (int lanes = mask; lanes; lanes &= lanes - 1) {
+            int lane = std::countr_zero(static_cast<unsigned>(lanes));
+            int triangle;
+            float u, v;
+            if (BLASRayCast(*obj.blas, *packet.rays[lane], packet.tMax[lane], triangle, u, v)) {
+                *packet.hits[lane] = { &obj, triangle, packet.tMax[lane], u, v };
+            }
+        }
+    }
+}
+
+// One ray through the subtree at node, walked in storage order so it needs no stack
+static void SingleRaySubtree(const FlatBVH& bvh, int node, RayPacket& packet, int lane) {
+    const Ray& ray = *packet.rays[lane];
+    glm::vec3 invDir = 1.0f / ray.direction;
+    int end = SkipIndex(bvh.links[node], node);
+    for (int i = node; i < end;) {
+        float tEntry;
+        if (!RayIntersectsAABB(ray, invDir, bvh.aabbVolumes[i], packet.tMax[lane], tEntry)) {
+            i = SkipIndex(bvh.links[i], i);
+            continue;
+        }
+        PacketLeaf(bvh, bvh.links[i], packet, 1 << lane);
+        ++i;
+    }
+}
+
+// Smallest entry distance among the rays in mask
+static float NearestEntry(__m128 tEntry, int mask) {
+    alignas(16) float entries[RAY_PACKET_SIZE];
+    _mm_store_ps(entries, tEntry);
+    float nearest = std::numeric_limits<float>::max();
+    for (int lanes = mask; lanes; lanes &= lanes - 1) {
+        nearest = std::min(nearest, entries[std::countr_zero(static_cast<unsigned>(lanes))]);
+    }
+    return nearest;
+}
+
+static void TracePacket(const FlatBVH& bvh, RayPacket& packet, int mask) {
+    PacketStackEntry localStack[RAY_STACK_SIZE];
+    PacketStackEntry* stack = localStack;
+    if (bvh.stackSize > RAY_STACK_SIZE) {
+        thread_local std::vector<PacketStackEntry> deepStack; // As RayCast's
+        if (static_cast<int>(deepStack.size()) < bvh.stackSize) deepStack.resize(bvh.stackSize);
+        stack = deepStack.data();
+    }
+    int top = 0;
+    __m128 tEntry;
+    mask &= PacketEntersBox(packet, bvh.aabbVolumes[0], _mm_load_ps(packet.tMax), tEntry);
+    if (mask) stack[top++] = { tEntry, 0, mask };
+
+    while (top > 0) {
+        PacketStackEntry entry = stack[--top];
+        __m128 tMax = _mm_load_ps(packet.tMax);
+        int active = entry.mask & _mm_movemask_ps(_mm_cmple_ps(entry.tEntry, tMax)); // Drop rays that hit something closer
+        if (!active) continue;
+
+        if (std::popcount(static_cast<unsigned>(active)) == 1) {
+            SingleRaySubtree(bvh, entry.node, packet, std::countr_zero(static_cast<unsigned>(active)));
+            continue;
+        }
+
+        const FlatLink& link = bvh.links[entry.node];
+        if (link.count > 0) {
+            PacketLeaf(bvh, link, packet, active);
+            continue;
+        }
+
+        // Push the children farthest first, ordered by where the first of their rays enters
+        int firstPushed = top;
+        for (int child = entry.node + 1; child < link.skipOrFirst; child = SkipIndex(bvh.links[child], child)) {
+            __m128 tChild;
+            int childMask = active & PacketEntersBox(packet, bvh.aabbVolumes[child], tMax, tChild);
+            if (!childMask) continue;
+
+            float nearest = NearestEntry(tChild, childMask);
+            int i = top++;
+            while (i > firstPushed && NearestEntry(stack[i - 1].tEntry, stack[i - 1].mask) < nearest) {
+                stack[i] = stack[i - 1];
+                --i;
+            }
+            stack[i] = { tChild, child, childMask };
+        }
+    }
+}
+
+// Whether the rays point into one octant and within a narrow cone, so they mostly enter
+// the same nodes
+static bool Coherent(std::span<const Ray> rays) {
+    glm::vec3 axis = glm::normalize(rays[0].direction);
+    for (const auto& ray : rays) {
+        if (glm::lessThan(ray.direction, glm::vec3(0.0f)) != glm::lessThan(rays[0].direction, glm::vec3(0.0f))) return false;
+        if (glm::dot(glm::normalize(ray.direction), axis) < RAY_PACKET_MIN_COS) return false;
+    }
+    return true;
+}
+
+void RayCastPackets(const FlatBVH& bvh, std::span<const Ray> rays, float tMax, std::span<RayHit> hits) {
+    for (size_t first = 0; first < rays.size(); first += RAY_PACKET_SIZE) {
+        size_t count = std::min<size_t>(RAY_PACKET_SIZE, rays.size() - first);
+        for (size_t i = first; i < first + count; ++i) {
+            hits[i] = { nullptr, -1, tMax, 0.0f, 0.0f };
+        }
+        if (bvh.NodeCount() == 0) continue;
+
+        std::span<const Ray> packetRays = rays.subspan(first, count);
+        if (count == 1 || !Coherent(packetRays)) {
+            for (size_t i = first; i < first + count; ++i) {
+                RayCast(bvh, rays[i], tMax, hits[i]);
+            }
+            continue;
+        }
+
+        // Unused lanes repeat the last ray and stay masked out
+        RayPacket packet;
+        alignas(16) float lanes[6][RAY_PACKET_SIZE];
+        for (int lane = 0; lane < RAY_PACKET_SIZE; ++lane) {
+            size_t i = first + std::min<size_t>(lane, count - 1);
+            glm::vec3 invDir = 1.0f / rays[i].direction;
+            for (int axis = 0; axis < 3; ++axis) {
+                lanes[axis][lane] = rays[i].start[axis];
+                lanes[3 + axis][lane] = invDir[axis];
+            }
+            packet.tMax[lane] = tMax;
+            packet.rays[lane] = &rays[i];
+            packet.hits[lane] = &hits[i];
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            packet.start[axis] = _mm_load_ps(lanes[axis]);
+            packet.invDir[axis] = _mm_load_ps(lanes[3 + axis]);
+        }
+        TracePacket(bvh, packet, (1 << count) - 1);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <span>
+#include "bvh.h"
+#include "blas.h"
+#include "flatbvh.h"
+
+// Rays traced together, one per SSE lane
+#define RAY_PACKET_SIZE 4
+// Packets whose directions spread wider than this cosine are traced ray by ray
+#define RAY_PACKET_MIN_COS 0.999f
+
+// Closest hits of rays, traced RAY_PACKET_SIZE at a time through the AABBs. A packet shares
+// one traversal stack and tests each node against all of its rays at once, masking out rays
+// that missed. hits[i].object is null when ray i hits nothing. Consecutive rays should be
+// coherent, like a 2x2 block of camera pixels. Packets whose directions point into different
+// octants or spread too far apart are traced ray by ray, and a packet continues ray by ray
+// below any node that only one of its rays enters.
+void RayCastPackets(const FlatBVH& bvh, std::span<const Ray> rays, float tMax, std::span<RayHit> hits);
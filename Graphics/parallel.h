@@ -0,0 +1,160 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Caps the worker threads when positive, so reports can measure scaling with core count
+inline int workerThreadLimit = 0;
+
+// Number of threads the parallel builders split their work across
+inline int NumWorkerThreads() {
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    return workerThreadLimit > 0 ? std::min(threads, workerThreadLimit) : threads;
+}
+
+// Calls fn(chunkBegin, chunkEnd, chunkIndex) for contiguous chunks of [begin, end), one thread per chunk.
+// The first chunk runs on the calling thread.
+template <typename Fn>
+void ParallelForChunks(int begin, int end, int numChunks, Fn fn) {
+    int count = end - begin;
+    if (count <= 0) return;
+    numChunks = std::clamp(numChunks, 1, count);
+    if (numChunks == 1) {
+        fn(begin, end, 0);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(numChunks - 1);
+    for (int c = 1; c < numChunks; ++c) {
+        int chunkBegin = begin + static_cast<int>(static_cast<long long>(count) * c / numChunks);
+        int chunkEnd = begin + static_cast<int>(static_cast<long long>(count) * (c + 1) / numChunks);
+        threads.emplace_back(fn, chunkBegin, chunkEnd, c);
+    }
+    fn(begin, begin + static_cast<int>(static_cast<long long>(count) / numChunks), 0);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Calls fn(i) for every i in [begin, end) across the worker threads, at least minChunk indices per thread
+template <typename Fn>
+void ParallelFor(int begin, int end, Fn fn, int minChunk = 1024) {
+    int numChunks = std::min(NumWorkerThreads(), std::max(1, (end - begin) / minChunk));
+    ParallelForChunks(begin, end, numChunks, [&](int chunkBegin, int chunkEnd, int) {
+        for (int i = chunkBegin; i < chunkEnd; ++i) {
+            fn(i);
+        }
+        });
+}
+
+// Threads kept alive between batches, so a batch wakes its workers instead of starting them and
+// anything a worker keeps in thread_local storage survives from one batch to the next. Threads
+// are started as batches first ask for them and parked on a condition variable in between.
+class WorkerPool {
+public:
+    static WorkerPool& Instance() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Calls fn(thread) once for every thread in [0, numThreads), thread 0 on the caller, and
+    // returns once all have finished. Batches from different callers take turns; a batch started
+    // from inside another, on a pool thread or on its caller, runs each call on that thread in turn.
+    template <typename Fn>
+    void Run(int numThreads, Fn& fn) {
+        if (numThreads <= 1 || insideBatch) {
+            for (int thread = 0; thread < numThreads; ++thread) {
+                fn(thread);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> batchLock(batchMutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (static_cast<int>(threads.size()) < numThreads - 1) {
+            threads.emplace_back(&WorkerPool::WorkerLoop, this, static_cast<int>(threads.size()) + 1, generation);
+        }
+        job = [](void* context, int thread) { (*static_cast<Fn*>(context))(thread); };
+        jobContext = &fn;
+        jobThreads = numThreads;
+        remaining = numThreads - 1;
+        ++generation;
+        lock.unlock();
+        wake.notify_all();
+
+        // The caller holds batchMutex while it runs its share, so it must not start another batch
+        insideBatch = true;
+        fn(0);
+        insideBatch = false;
+
+        lock.lock();
+        done.wait(lock, [this] { return remaining == 0; });
+    }
+
+private:
+    WorkerPool() = default;
+
+    void WorkerLoop(int thread, int seen) {
+        insideBatch = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (thread >= jobThreads) continue;
+
+            lock.unlock();
+            job(jobContext, thread);
+            lock.lock();
+            if (--remaining == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::mutex batchMutex; // Held for a whole batch
+    std::mutex mutex;      // Guards everything below
+    std::condition_variable wake, done;
+    std::vector<std::thread> threads; // threads[i] runs as thread i + 1
+    void (*job)(void*, int) = nullptr;
+    void* jobContext = nullptr;
+    int jobThreads = 0;
+    int remaining = 0;  // Pool threads still working on the current batch
+    int generation = 0; // Bumped for every batch
+    bool stopping = false;
+    static inline thread_local bool insideBatch = false; // Set on pool threads, and on a caller running its share
+};
+
+// Calls fn(chunkBegin, chunkEnd, thread) for chunks of chunkSize indices of [begin, end) on the
+// WorkerPool. Each thread claims the next unclaimed chunk as soon as it finishes one, so threads
+// that draw cheap chunks take on more of them. thread is in [0, NumWorkerThreads()).
+template <typename Fn>
+void ParallelForDynamic(int begin, int end, int chunkSize, Fn fn) {
+    if (end <= begin) return;
+    int numChunks = (end - begin + chunkSize - 1) / chunkSize;
+    int numThreads = std::min(NumWorkerThreads(), numChunks);
+    std::atomic<int> nextChunk = 0;
+    auto claimChunks = [&](int thread) {
+        for (int chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++) {
+            int chunkBegin = begin + chunk * chunkSize;
+            fn(chunkBegin, std::min(end, chunkBegin + chunkSize), thread);
+        }
+        };
+    WorkerPool::Instance().Run(numThreads, claimChunks);
+}
@@ -0,0 +1,143 @@
+#include "ploc.h"
+#include "morton.h"
+#include "nodearena.h"
+#include "parallel.h"
+#include <limits>
+#include <new>
+#include <numeric>
+
+// Clusters below this many per thread are not worth a thread of their own
+#define PLOC_MIN_CHUNK 512
+
+static float ClusterDistance(const TreeNode* a, const TreeNode* b, PLOCDistance distance) {
+    if (distance == PD_BOUNDING_VOLUME_COST) {
+        return MergeCost(a, b);
+    }
+    return SurfaceArea(MergeAABB(a->aabbVolume, b->aabbVolume));
+}
+
+// Exclusive prefix sum of flags into offsets, one chunk per thread; returns the total
+static int ParallelPrefixSum(const std::vector<int>& flags, std::vector<int>& offsets) {
+    int n = static_cast<int>(flags.size());
+    int numChunks = std::min(NumWorkerThreads(), std::max(1, n / PLOC_MIN_CHUNK));
+    std::vector<int> chunkSums(numChunks + 1, 0);
+    offsets.resize(n);
+
+    ParallelForChunks(0, n, numChunks, [&](int begin, int end, int chunk) {
+        int sum = 0;
+        for (int i = begin; i < end; ++i) {
+            sum += flags[i];
+        }
+        chunkSums[chunk + 1] = sum;
+        });
+    std::partial_sum(chunkSums.begin(), chunkSums.end(), chunkSums.begin());
+    ParallelForChunks(0, n, numChunks, [&](int begin, int end, int chunk) {
+        int sum = chunkSums[chunk];
+        for (int i = begin; i < end; ++i) {
+            offsets[i] = sum;
+            sum += flags[i];
+        }
+        });
+    return chunkSums[numChunks];
+}
+
+TreeNode* PLOCTree(NodeArena& arena, const std::vector<Object>& objects, int radius, PLOCDistance distance) {
+    int n = static_cast<int>(objects.size());
+    if (n == 0) return nullptr;
+    radius = std::max(radius, 1);
+
+    // Sort object centers along the Morton curve
+    std::vector<glm::vec3> centers(n);
+    AABB centerBounds;
+    centerBounds.min = glm::vec3(std::numeric_limits<float>::max());
+    centerBounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (int i = 0; i < n; ++i) {
+        centers[i] = (objects[i].boundingBox.min + objects[i].boundingBox.max) * 0.5f;
+        centerBounds.min = glm::min(centerBounds.min, centers[i]);
+        centerBounds.max = glm::max(centerBounds.max, centers[i]);
+    }
+
+    std::vector<uint64_t> codes;
+    ComputeMortonCodes(centers, centerBounds, 63, codes);
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    RadixSortPairs(codes, order, 63);
+
+    TreeNode* leaves = arena.NewArray(n);
+    std::vector<TreeNode*> clusters(n);
+    ParallelFor(0, n, [&](int i) {
+        const Object& obj = objects[order[i]];
+        TreeNode* leaf = &leaves[i];
+        leaf->aabbVolume = obj.boundingBox;
+        leaf->ritterVolume = obj.ritterSphere;
+        leaf->larssonVolume = obj.larssonSphere;
+        leaf->pcaVolume = obj.pcaSphere;
+        leaf->objects = const_cast<Object*>(&obj);
+        leaf->numObjects = 1;
+        clusters[i] = leaf;
+        });
+
+    std::vector<int> neighbours;
+    std::vector<int> merges;
+    std::vector<int> offsets;
+    std::vector<TreeNode*> next;
+    while (clusters.size() > 1 && !BuildCancelled()) {
+        int count = static_cast<int>(clusters.size());
+
+        // Nearest neighbour within the radius. Ties go to the lower index so that,
+        // distances being symmetric, the globally closest pair is always mutual.
+        neighbours.resize(count);
+        ParallelFor(0, count, [&](int i) {
+            float best = std::numeric_limits<float>::max();
+            int bestIndex = i > 0 ? i - 1 : i + 1;
+            int last = std::min(count - 1, i + radius);
+            for (int j = std::max(0, i - radius); j <= last; ++j) {
+                if (j == i) continue;
+                float d = ClusterDistance(clusters[i], clusters[j], distance);
+                if (d < best) {
+                    best = d;
+                    bestIndex = j;
+                }
+            }
+            neighbours[i] = bestIndex;
+            }, PLOC_MIN_CHUNK);
+
+        // The lower index of each mutual pair creates the parent in its slot
+        merges.resize(count);
+        ParallelFor(0, count, [&](int i) {
+            int j = neighbours[i];
+            merges[i] = neighbours[j] == i && i < j;
+            }, PLOC_MIN_CHUNK);
+        int numMerges = ParallelPrefixSum(merges, offsets);
+
+        // The arena is not thread-safe, so every parent of this pass comes from one block
+        TreeNode* parents = arena.NewArray(numMerges);
+        ParallelFor(0, count, [&](int i) {
+            if (merges[i]) {
+                int j = neighbours[i];
+                clusters[i] = new (&parents[offsets[i]]) TreeNode(clusters[i], clusters[j]);
+                clusters[j] = nullptr;
+            }
+            }, PLOC_MIN_CHUNK);
+
+        // Compact the survivors, keeping their Morton order
+        ParallelFor(0, count, [&](int i) {
+            merges[i] = clusters[i] != nullptr;
+            }, PLOC_MIN_CHUNK);
+        int survivors = ParallelPrefixSum(merges, offsets);
+        next.resize(survivors);
+        ParallelFor(0, count, [&](int i) {
+            if (clusters[i]) {
+                next[offsets[i]] = clusters[i];
+            }
+            }, PLOC_MIN_CHUNK);
+        clusters.swap(next);
+    }
+
+    // A cancelled build chains what is left so the arena still holds one tree
+    TreeNode* root = clusters[0];
+    for (size_t i = 1; i < clusters.size(); ++i) {
+        root = arena.New(root, clusters[i]);
+    }
+    return root;
+}
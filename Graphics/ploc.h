@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+// Clusters each cluster compares itself with on either side along the Morton curve
+#define PLOC_RADIUS 16
+
+// What the PLOC builder minimises when choosing a cluster's neighbour
+enum PLOCDistance {
+    PD_SURFACE_AREA,        // Surface area of the merged AABB, as in the surface area heuristic
+    PD_BOUNDING_VOLUME_COST // MergeCost, the bottom-up builder's heuristic
+};
+
+// Parallel locally-ordered clustering (Meister and Bittner 2018). Leaves are sorted along
+// a Morton curve; every pass each cluster finds its nearest neighbour among the radius
+// clusters on either side, mutual nearest neighbours are merged and the survivors are
+// compacted in order, until one cluster remains. Every step of a pass runs in parallel.
+// Leaves point into objects, which must outlive the tree.
+TreeNode* PLOCTree(NodeArena& arena, const std::vector<Object>& objects, int radius = PLOC_RADIUS, PLOCDistance distance = PD_SURFACE_AREA);
@@ -0,0 +1,257 @@
+#include "qbvh.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Grid exponents stay clear of denormal and infinite scales
+#define QBVH_MIN_EXPONENT -100
+#define QBVH_MAX_EXPONENT 127
+
+struct QBVHStackEntry {
+    int node;
+    float tEntry;
+};
+
+static float GridScale(int exponent) {
+    return std::ldexp(1.0f, exponent);
+}
+
+// Smallest power of two grid whose 255 steps from origin reach max
+static int GridExponent(float origin, float max) {
+    float extent = max - origin;
+    int exponent = extent > 0.0f ? static_cast<int>(std::ceil(std::log2(extent / 255.0f))) : QBVH_MIN_EXPONENT;
+    exponent = std::clamp(exponent, QBVH_MIN_EXPONENT, QBVH_MAX_EXPONENT);
+    while (exponent < QBVH_MAX_EXPONENT && origin + 255.0f * GridScale(exponent) < max) {
+        exponent++;
+    }
+    return exponent;
+}
+
+// Grid steps for a child's min and max, moved outwards until the decoded values enclose them
+static void Quantize(float origin, int exponent, float min, float max, uint8_t& qmin, uint8_t& qmax) {
+    float scale = GridScale(exponent);
+    int lo = std::clamp(static_cast<int>(std::floor((min - origin) / scale)), 0, 255);
+    int hi = std::clamp(static_cast<int>(std::ceil((max - origin) / scale)), 0, 255);
+    while (lo > 0 && origin + static_cast<float>(lo) * scale > min) lo--;
+    while (hi < 255 && origin + static_cast<float>(hi) * scale < max) hi++;
+    qmin = static_cast<uint8_t>(lo);
+    qmax = static_cast<uint8_t>(hi);
+}
+
+// Encodes items as the children of a new node and returns its index. Internal items with the
+// largest area are opened while their children fit; more than four items are split into groups.
+static int EncodeNode(QBVH& qbvh, std::vector<TreeNode*> items, int depth) {
+    std::erase_if(items, [](TreeNode* item) { return item->type == LEAF && item->numObjects == 0; });
+    while (items.size() < QBVH_WIDTH) {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int i = 0; i < static_cast<int>(items.size()); ++i) {
+            if (items[i]->type == INTERNAL && items.size() - 1 + items[i]->numChildren <= QBVH_WIDTH && SurfaceArea(items[i]->aabbVolume) > bestArea) {
+                best = i;
+                bestArea = SurfaceArea(items[i]->aabbVolume);
+            }
+        }
+        if (best < 0) break;
+
+        TreeNode* opened = items[best];
+        items.erase(items.begin() + best);
+        items.insert(items.end(), opened->children, opened->children + opened->numChildren);
+    }
+
+    int numSlots = std::min(static_cast<int>(items.size()), QBVH_WIDTH);
+    std::vector<TreeNode*> slots[QBVH_WIDTH];
+    AABB slotBounds[QBVH_WIDTH];
+    AABB bounds = { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (int s = 0; s < numSlots; ++s) {
+        slots[s].assign(items.begin() + s * items.size() / numSlots, items.begin() + (s + 1) * items.size() / numSlots);
+        slotBounds[s] = slots[s][0]->aabbVolume;
+        for (TreeNode* item : slots[s]) {
+            slotBounds[s] = MergeAABB(slotBounds[s], item->aabbVolume);
+        }
+        bounds = MergeAABB(bounds, slotBounds[s]);
+    }
+
+    int index = static_cast<int>(qbvh.nodes.size());
+    qbvh.nodes.emplace_back();
+    qbvh.depth = std::max(qbvh.depth, depth + 1);
+
+    QBVHNode node = {};
+    node.numChildren = static_cast<uint8_t>(numSlots);
+    uint8_t* qmin[3] = { node.qminX, node.qminY, node.qminZ };
+    uint8_t* qmax[3] = { node.qmaxX, node.qmaxY, node.qmaxZ };
+    for (int axis = 0; axis < 3; ++axis) {
+        node.origin[axis] = bounds.min[axis];
+        int exponent = GridExponent(bounds.min[axis], bounds.max[axis]);
+        node.exponent[axis] = static_cast<int8_t>(exponent);
+        for (int s = 0; s < numSlots; ++s) {
+            Quantize(bounds.min[axis], exponent, slotBounds[s].min[axis], slotBounds[s].max[axis], qmin[axis][s], qmax[axis][s]);
+        }
+    }
+
+    for (int s = 0; s < numSlots; ++s) {
+        TreeNode* item = slots[s][0];
+        if (slots[s].size() == 1 && item->type == LEAF) {
+            node.child[s] = static_cast<int32_t>(qbvh.primitives.size());
+            node.leafCount[s] = static_cast<uint16_t>(item->numObjects);
+            for (int i = 0; i < item->numObjects; ++i) {
+                qbvh.primitives.push_back(static_cast<int>(&item->LeafObject(i) - qbvh.objects));
+            }
+        }
+        else if (slots[s].size() == 1) {
+            node.child[s] = EncodeNode(qbvh, std::vector<TreeNode*>(item->children, item->children + item->numChildren), depth + 1);
+        }
+        else {
+            node.child[s] = EncodeNode(qbvh, slots[s], depth + 1);
+        }
+    }
+    qbvh.nodes[index] = node;
+    return index;
+}
+
+QBVH BuildQBVH(TreeNode* root, std::span<const Object> objects) {
+    QBVH qbvh;
+    qbvh.objects = objects.data();
+    if (!root || root->numObjects == 0) return qbvh;
+
+    qbvh.primitives.reserve(root->numObjects);
+    if (root->type == LEAF) {
+        EncodeNode(qbvh, { root }, 0);
+    }
+    else {
+        EncodeNode(qbvh, std::vector<TreeNode*>(root->children, root->children + root->numChildren), 0);
+    }
+    return qbvh;
+}
+
+// The four children's bounds on one axis, decoded from their grid steps
+static inline __m128 DecodeAxis(const uint8_t* steps, float origin, int8_t exponent) {
+    int packed;
+    std::memcpy(&packed, steps, sizeof(packed));
+    __m128i zero = _mm_setzero_si128();
+    __m128i ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+    __m128 scale = _mm_castsi128_ps(_mm_set1_epi32((exponent + 127) << 23));
+    return _mm_add_ps(_mm_set1_ps(origin), _mm_mul_ps(_mm_cvtepi32_ps(ints), scale));
+}
+
+static inline int ValidChildren(const QBVHNode& node) {
+    return (1 << node.numChildren) - 1;
+}
+
+// Bit per child whose box the ray enters before tMax, with the entry distances
+static inline int RayChildMask(const QBVHNode& node, const __m128 start[3], const __m128 invDir[3], float tMax, __m128& tEntry) {
+    const uint8_t* qmin[3] = { node.qminX, node.qminY, node.qminZ };
+    const uint8_t* qmax[3] = { node.qmaxX, node.qmaxY, node.qmaxZ };
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = _mm_set1_ps(tMax);
+    for (int axis = 0; axis < 3; ++axis) {
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(DecodeAxis(qmin[axis], node.origin[axis], node.exponent[axis]), start[axis]), invDir[axis]);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(DecodeAxis(qmax[axis], node.origin[axis], node.exponent[axis]), start[axis]), invDir[axis]);
+        tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+        tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+    }
+    tEntry = tNear;
+    return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & ValidChildren(node);
+}
+
+// Bit per child whose box overlaps the query box
+static inline int BoxChildMask(const QBVHNode& node, const __m128 boxMin[3], const __m128 boxMax[3]) {
+    const uint8_t* qmin[3] = { node.qminX, node.qminY, node.qminZ };
+    const uint8_t* qmax[3] = { node.qmaxX, node.qmaxY, node.qmaxZ };
+    __m128 overlap = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int axis = 0; axis < 3; ++axis) {
+        __m128 lo = DecodeAxis(qmin[axis], node.origin[axis], node.exponent[axis]);
+        __m128 hi = DecodeAxis(qmax[axis], node.origin[axis], node.exponent[axis]);
+        overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(lo, boxMax[axis]), _mm_cmpge_ps(hi, boxMin[axis])));
+    }
+    return _mm_movemask_ps(overlap) & ValidChildren(node);
+}
+
+bool QBVHRayCast(const QBVH& qbvh, const Ray& ray, float tMax, RayHit& hit) {
+    if (qbvh.nodes.empty()) return false;
+
+    QBVHStackEntry localStack[QBVH_STACK_SIZE];
+    std::vector<QBVHStackEntry> heapStack;
+    QBVHStackEntry* stack = localStack;
+    if ((QBVH_WIDTH - 1) * qbvh.depth + 1 > QBVH_STACK_SIZE) {
+        heapStack.resize((QBVH_WIDTH - 1) * qbvh.depth + 1);
+        stack = heapStack.data();
+    }
+
+    glm::vec3 invDir = 1.0f / ray.direction;
+    __m128 start[3] = { _mm_set1_ps(ray.start.x), _mm_set1_ps(ray.start.y), _mm_set1_ps(ray.start.z) };
+    __m128 inv[3] = { _mm_set1_ps(invDir.x), _mm_set1_ps(invDir.y), _mm_set1_ps(invDir.z) };
+    bool found = false;
+    int top = 0;
+    stack[top++] = { 0, 0.0f };
+
+    while (top > 0) {
+        QBVHStackEntry entry = stack[--top];
+        if (entry.tEntry > tMax) continue; // A closer hit was found since this node was pushed
+
+        const QBVHNode& node = qbvh.nodes[entry.node];
+        __m128 tEntries;
+        int mask = RayChildMask(node, start, inv, tMax, tEntries);
+        alignas(16) float childEntry[QBVH_WIDTH];
+        _mm_store_ps(childEntry, tEntries);
+
+        // Leaves are tested right away; nodes are pushed farthest first so the nearest is popped next
+        int firstPushed = top;
+        for (int c = 0; c < QBVH_WIDTH; ++c) {
+            if (!(mask & (1 << c))) continue;
+
+            if (node.leafCount[c] == 0) {
+                stack[top++] = { node.child[c], childEntry[c] };
+                continue;
+            }
+            for (int p = node.child[c]; p < node.child[c] + node.leafCount[c]; ++p) {
+                const Object& obj = qbvh.objects[qbvh.primitives[p]];
+                int triangle;
+                float u, v;
+                if (obj.blas && BLASRayCast(*obj.blas, ray, tMax, triangle, u, v)) {
+                    hit = { &obj, triangle, tMax, u, v };
+                    found = true;
+                }
+            }
+        }
+        std::sort(stack + firstPushed, stack + top, [](const QBVHStackEntry& a, const QBVHStackEntry& b) { return a.tEntry > b.tEntry; });
+    }
+    return found;
+}
+
+void QBVHOverlap(const QBVH& qbvh, const AABB& box, std::vector<const Object*>& results) {
+    if (qbvh.nodes.empty()) return;
+
+    int localStack[QBVH_STACK_SIZE];
+    std::vector<int> heapStack;
+    int* stack = localStack;
+    if ((QBVH_WIDTH - 1) * qbvh.depth + 1 > QBVH_STACK_SIZE) {
+        heapStack.resize((QBVH_WIDTH - 1) * qbvh.depth + 1);
+        stack = heapStack.data();
+    }
+
+    __m128 boxMin[3] = { _mm_set1_ps(box.min.x), _mm_set1_ps(box.min.y), _mm_set1_ps(box.min.z) };
+    __m128 boxMax[3] = { _mm_set1_ps(box.max.x), _mm_set1_ps(box.max.y), _mm_set1_ps(box.max.z) };
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const QBVHNode& node = qbvh.nodes[stack[--top]];
+        int mask = BoxChildMask(node, boxMin, boxMax);
+        for (int c = 0; c < QBVH_WIDTH; ++c) {
+            if (!(mask & (1 << c))) continue;
+
+            if (node.leafCount[c] == 0) {
+                stack[top++] = node.child[c];
+                continue;
+            }
+            for (int p = node.child[c]; p < node.child[c] + node.leafCount[c]; ++p) {
+                const Object& obj = qbvh.objects[qbvh.primitives[p]];
+                if (AABBOverlap(obj.boundingBox, box) && obj.blas && BLASOverlaps(*obj.blas, box)) {
+                    results.push_back(&obj);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "bvh.h"
+#include "blas.h"
+
+#define QBVH_WIDTH 4
+// Entries a query's traversal stack holds before it moves to the heap
+#define QBVH_STACK_SIZE 256
+
+// Compressed 4-wide node in one cache line. Child boxes are stored as 8-bit offsets on a grid
+// spanning the node's box: min = origin + qmin * 2^exponent on each axis, max likewise with qmax.
+// Offsets are rounded outwards, so a decoded box always contains the child.
+struct alignas(64) QBVHNode {
+    float origin[3];
+    int8_t exponent[3];
+    uint8_t numChildren;
+    uint8_t qminX[QBVH_WIDTH], qminY[QBVH_WIDTH], qminZ[QBVH_WIDTH];
+    uint8_t qmaxX[QBVH_WIDTH], qmaxY[QBVH_WIDTH], qmaxZ[QBVH_WIDTH];
+    int32_t child[QBVH_WIDTH];       // Node index, or first entry in primitives for a leaf
+    uint16_t leafCount[QBVH_WIDTH];  // Objects in a leaf child, at most 65535; 0 for node children
+};
+static_assert(sizeof(QBVHNode) == 64, "QBVHNode must fill exactly one cache line");
+
+// Quantized 4-wide tree built from any object BVH, for scenes whose uncompressed
+// nodes no longer fit in cache. Queries decode four child boxes at a time with SSE.
+struct QBVH {
+    std::vector<QBVHNode> nodes;     // nodes[0] is the root
+    std::vector<int> primitives;     // Objects of each leaf, as indices into objects
+    const Object* objects = nullptr; // The array the tree's leaves pointed into
+    int depth = 0;
+
+    size_t Bytes() const { return nodes.capacity() * sizeof(QBVHNode) + primitives.capacity() * sizeof(int); }
+};
+
+// Every leaf must point into objects, which must outlive the result. Binary subtrees are
+// pulled up into each node until it holds four children; nodes wider than four are split.
+QBVH BuildQBVH(TreeNode* root, std::span<const Object> objects);
+
+// Same queries as FlatRayCast and FlatOverlap
+bool QBVHRayCast(const QBVH& qbvh, const Ray& ray, float tMax, RayHit& hit);
+void QBVHOverlap(const QBVH& qbvh, const AABB& box, std::vector<const Object*>& results);
@@ -0,0 +1,90 @@
+#include "raycast.h"
+#include <vector>
+
+struct RayStackEntry {
+    int node;
+    float tEntry;
+};
+
+static bool RayEntersNode(const FlatBVH& bvh, int node, const Ray& ray, const glm::vec3& invDir, const BoundingSphere* spheres, float tMax, float& tEntry) {
+    if (spheres) {
+        return RayIntersectsSphere(ray, spheres[node], tMax, tEntry);
+    }
+    return RayIntersectsAABB(ray, invDir, bvh.aabbVolumes[node], tMax, tEntry);
+}
+
+// Tests a leaf's objects. Returns true once an occlusion query can stop.
+static bool RayCastLeaf(const FlatBVH& bvh, const FlatLink& link, const Ray& ray, float& tMax, RayHit* hit, bool& found) {
+    for (int p = link.skipOrFirst; p < link.skipOrFirst + link.count; ++p) {
+        const Object& obj = bvh.objects[bvh.primitives[p]];
+        if (!obj.blas) continue;
+
+        if (!hit) {
+            if (BLASOccluded(*obj.blas, ray, tMax)) return found = true;
+            continue;
+        }
+        int triangle;
+        float u, v;
+        if (BLASRayCast(*obj.blas, ray, tMax, triangle, u, v)) {
+            *hit = { &obj, triangle, tMax, u, v };
+            found = true;
+        }
+    }
+    return false;
+}
+
+// Any-hit queries pass no hit
+static bool Trace(const FlatBVH& bvh, const Ray& ray, float tMax, RayHit* hit, BoundingVolumeType bvType) {
+    if (bvh.NodeCount() == 0) return false;
+
+    glm::vec3 invDir = 1.0f / ray.direction;
+    const BoundingSphere* spheres = bvType >= BVT_RITTER_SPHERE ? bvh.Spheres(bvType).data() : nullptr;
+    bool found = false;
+
+    RayStackEntry localStack[RAY_STACK_SIZE];
+    RayStackEntry* stack = localStack;
+    if (bvh.stackSize > RAY_STACK_SIZE) {
+        // Grown once per thread to the deepest tree it has walked, then reused
+        thread_local std::vector<RayStackEntry> deepStack;
+        if (static_cast<int>(deepStack.size()) < bvh.stackSize) deepStack.resize(bvh.stackSize);
+        stack = deepStack.data();
+    }
+    int top = 0;
+    float tEntry;
+    if (!RayEntersNode(bvh, 0, ray, invDir, spheres, tMax, tEntry)) return false;
+    stack[top++] = { 0, tEntry };
+
+    while (top > 0) {
+        RayStackEntry entry = stack[--top];
+        if (entry.tEntry > tMax) continue; // A closer hit was found since this node was pushed
+
+        const FlatLink& link = bvh.links[entry.node];
+        if (link.count > 0) {
+            if (RayCastLeaf(bvh, link, ray, tMax, hit, found)) return true;
+            continue;
+        }
+
+        // Push the children the ray enters farthest first, so the nearest is popped next
+        int firstPushed = top;
+        for (int child = entry.node + 1; child < link.skipOrFirst; child = SkipIndex(bvh.links[child], child)) {
+            float tChild;
+            if (!RayEntersNode(bvh, child, ray, invDir, spheres, tMax, tChild)) continue;
+
+            int i = top++;
+            while (i > firstPushed && stack[i - 1].tEntry < tChild) {
+                stack[i] = stack[i - 1];
+                --i;
+            }
+            stack[i] = { child, tChild };
+        }
+    }
+    return found;
+}
+
+bool RayCast(const FlatBVH& bvh, const Ray& ray, float tMax, RayHit& hit, BoundingVolumeType bvType) {
+    return Trace(bvh, ray, tMax, &hit, bvType);
+}
+
+bool RayOccluded(const FlatBVH& bvh, const Ray& ray, float tMax, BoundingVolumeType bvType) {
+    return Trace(bvh, ray, tMax, nullptr, bvType);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "bvh.h"
+#include "blas.h"
+#include "flatbvh.h"
+
+// Entries of the traversal stack kept on the call stack. Trees whose stackSize exceeds it use
+// a stack each thread grows once and then reuses, so queries do not allocate per call.
+#define RAY_STACK_SIZE 256
+
+// Closest triangle hit closer than tMax. Nodes are culled with their bvType volumes and
+// children are visited nearest first, so subtrees behind the closest hit so far are never entered.
+bool RayCast(const FlatBVH& bvh, const Ray& ray, float tMax, RayHit& hit, BoundingVolumeType bvType = BVT_AABB);
+// Whether any triangle is hit closer than tMax, returning at the first one found; for
+// shadow and line-of-sight tests, which need no hit details
+bool RayOccluded(const FlatBVH& bvh, const Ray& ray, float tMax, BoundingVolumeType bvType = BVT_AABB);
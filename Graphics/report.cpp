@@ -0,0 +1,1260 @@
+#include "report.h"
+#include "sbvh.h"
+#include "blas.h"
+#include "lbvh.h"
+#include "ploc.h"
+#include "aac.h"
+#include "insertion.h"
+#include "flatbvh.h"
+#include "qbvh.h"
+#include "childtests.h"
+#include "bvhfile.h"
+#include "nodeorder.h"
+#include "raycast.h"
+#include "packet.h"
+#include "batchquery.h"
+#include "parallel.h"
+#include "trbvh.h"
+#include "nodearena.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <climits>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <cmath>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+
+static const char* splitMethodNames[] = { "Median of Centers", "Median of Extents", "K Even Splits", "Surface Area Heuristic" };
+static const char* axisMethodNames[] = { "Round Robin", "Longest Extent", "Max Variance", "Best Cost" };
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Rays starting inside the scene bounds, heading in uniformly random directions
+static std::vector<Ray> RandomRays(const AABB& bounds, int count, unsigned int seed = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 start = bounds.min + (bounds.max - bounds.min) * glm::vec3(unit(rng), unit(rng), unit(rng));
+        glm::vec3 direction = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng)));
+        rays.push_back({ start, direction });
+    }
+    return rays;
+}
+
+// Query boxes scattered over the scene, each relativeSize of the scene diagonal across
+static std::vector<AABB> RandomBoxes(const AABB& bounds, int count, float relativeSize, unsigned int seed = 2) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    glm::vec3 halfExtent(glm::length(bounds.max - bounds.min) * relativeSize * 0.5f);
+
+    std::vector<AABB> boxes;
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 center = bounds.min + (bounds.max - bounds.min) * glm::vec3(unit(rng), unit(rng), unit(rng));
+        boxes.push_back({ center - halfExtent, center + halfExtent });
+    }
+    return boxes;
+}
+
+void ReportAxisMethods(std::vector<Object>& objects) {
+    SplitMethod savedSplitMethod = currentSplitMethod;
+    AxisMethod savedAxisMethod = currentAxisMethod;
+    bool savedMaxHeight = maxHeight;
+    maxHeight = false; // Build down to single-object leaves
+
+    std::vector<Object*> work = ObjectPointers(objects);
+
+    std::cout << "\n== Top-down split axis (" << objects.size() << " objects) ==\n";
+    std::cout << std::left << std::setw(24) << "Split" << std::setw(16) << "Axis"
+        << std::right << std::setw(8) << "Depth" << std::setw(10) << "Nodes"
+        << std::setw(16) << "Node Volume" << std::setw(12) << "SAH Cost" << std::setw(12) << "Build ms" << "\n";
+
+    for (int split = 0; split < static_cast<int>(std::size(splitMethodNames)); ++split) {
+        for (int axis = 0; axis < static_cast<int>(std::size(axisMethodNames)); ++axis) {
+            currentSplitMethod = static_cast<SplitMethod>(split);
+            currentAxisMethod = static_cast<AxisMethod>(axis);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            NodeArena arena;
+            TreeNode* root = arena.New();
+            TopDownTree(arena, root, work, 0, INT_MAX);
+            double buildMs = MillisecondsSince(start);
+
+            std::cout << std::left << std::setw(24) << splitMethodNames[split] << std::setw(16) << axisMethodNames[axis]
+                << std::right << std::setw(8) << TreeDepth(root) << std::setw(10) << CountNodes(root)
+                << std::setw(16) << std::scientific << std::setprecision(4) << TotalNodeVolume(root)
+                << std::setw(12) << std::fixed << std::setprecision(2) << TreeSAHCost(root)
+                << std::setw(12) << buildMs << "\n";
+
+        }
+    }
+
+    currentSplitMethod = savedSplitMethod;
+    currentAxisMethod = savedAxisMethod;
+    maxHeight = savedMaxHeight;
+}
+
+void ReportSpatialSplits(std::vector<Object>& objects) {
+    const int NUM_QUERIES = 2000;
+    AABB sceneBounds = ComputeAABB(objects);
+    std::vector<Ray> rays = RandomRays(sceneBounds, NUM_QUERIES);
+    std::vector<AABB> boxes = RandomBoxes(sceneBounds, NUM_QUERIES, 0.01f);
+
+    std::cout << "\n== Spatial splits (" << NUM_QUERIES << " rays and boxes) ==\n";
+    std::cout << std::left << std::setw(28) << "Structure" << std::right << std::setw(12) << "Primitives"
+        << std::setw(10) << "Nodes" << std::setw(8) << "Depth" << std::setw(14) << "Ray Visits"
+        << std::setw(14) << "Box Visits" << std::setw(12) << "Build ms" << "\n";
+
+    auto printRow = [](const char* name, size_t primitives, size_t nodes, int depth, double rayVisits, double boxVisits, double buildMs) {
+        std::cout << std::left << std::setw(28) << name << std::right << std::setw(12) << primitives
+            << std::setw(10) << nodes << std::setw(8) << depth << std::fixed << std::setprecision(1)
+            << std::setw(14) << rayVisits << std::setw(14) << boxVisits << std::setw(12) << buildMs << "\n";
+        };
+
+    // Object-granularity tree from the top-down builder
+    {
+        SplitMethod savedSplitMethod = currentSplitMethod;
+        bool savedMaxHeight = maxHeight;
+        currentSplitMethod = SM_SAH;
+        maxHeight = false;
+
+        std::vector<Object*> work = ObjectPointers(objects);
+        auto start = std::chrono::high_resolution_clock::now();
+        NodeArena arena;
+        TreeNode* root = arena.New();
+        TopDownTree(arena, root, work, 0, INT_MAX);
+        double buildMs = MillisecondsSince(start);
+
+        double rayVisits = 0.0, boxVisits = 0.0;
+        for (const auto& ray : rays) rayVisits += RayNodeVisits(root, ray, std::numeric_limits<float>::max());
+        for (const auto& box : boxes) boxVisits += OverlapNodeVisits(root, box);
+        printRow("Top-down SAH (objects)", objects.size(), CountNodes(root), TreeDepth(root),
+            rayVisits / NUM_QUERIES, boxVisits / NUM_QUERIES, buildMs);
+
+        currentSplitMethod = savedSplitMethod;
+        maxHeight = savedMaxHeight;
+    }
+
+    // Triangle trees: object splits only, then with spatial splits allowed
+    const float budgets[] = { 0.0f, 0.3f };
+    const char* names[] = { "Object splits (triangles)", "SBVH, 30% duplication" };
+    for (int i = 0; i < 2; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        SBVH sbvh = BuildSBVH(objects, budgets[i]);
+        double buildMs = MillisecondsSince(start);
+
+        double rayVisits = 0.0, boxVisits = 0.0;
+        for (const auto& ray : rays) rayVisits += SBVHRayNodeVisits(sbvh, ray, std::numeric_limits<float>::max());
+        for (const auto& box : boxes) boxVisits += SBVHOverlapNodeVisits(sbvh, box);
+        printRow(names[i], sbvh.refs.size(), sbvh.nodes.size(), SBVHDepth(sbvh),
+            rayVisits / NUM_QUERIES, boxVisits / NUM_QUERIES, buildMs);
+    }
+}
+
+void ReportTriangleBLAS(std::vector<Object>& objects) {
+    const int NUM_RAYS = 500;
+    AABB sceneBounds = ComputeAABB(objects);
+    std::vector<Ray> rays = RandomRays(sceneBounds, NUM_RAYS, 3);
+
+    size_t numTriangles = 0, numNodes = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto& obj : objects) {
+        obj.blas = std::make_shared<BLAS>(BuildBLAS(obj.mesh));
+        numTriangles += obj.blas->triangles.size();
+        numNodes += obj.blas->nodes.size();
+    }
+    double buildMs = MillisecondsSince(start);
+
+    SplitMethod savedSplitMethod = currentSplitMethod;
+    bool savedMaxHeight = maxHeight;
+    currentSplitMethod = SM_SAH;
+    maxHeight = false;
+    std::vector<Object*> work = ObjectPointers(objects);
+    NodeArena arena;
+    TreeNode* root = arena.New();
+    TopDownTree(arena, root, work, 0, INT_MAX);
+    currentSplitMethod = savedSplitMethod;
+    maxHeight = savedMaxHeight;
+
+    // Object BVH descending into each object's triangle BVH
+    std::vector<RayHit> hits(NUM_RAYS);
+    std::vector<bool> found(NUM_RAYS);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_RAYS; ++i) {
+        found[i] = RayCastTree(root, rays[i], std::numeric_limits<float>::max(), hits[i]);
+    }
+    double treeMs = MillisecondsSince(start);
+
+    // Reference: every triangle of every object
+    int mismatches = 0, numHits = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_RAYS; ++i) {
+        float closest = std::numeric_limits<float>::max();
+        for (const auto& obj : objects) {
+            for (const auto& tri : obj.blas->triangles) {
+                float t, u, v;
+                if (IntersectRayTriangle(rays[i], tri, closest, t, u, v)) closest = t;
+            }
+        }
+        bool bruteFound = closest < std::numeric_limits<float>::max();
+        numHits += bruteFound;
+        if (bruteFound != found[i] || (bruteFound && std::abs(closest - hits[i].t) > 1e-3f * std::max(1.0f, closest))) {
+            mismatches++;
+        }
+    }
+    double bruteMs = MillisecondsSince(start);
+
+    std::cout << "\n== Per-object triangle BVH (" << numTriangles << " triangles, " << numNodes << " nodes) ==\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Build all BLAS:          " << buildMs << " ms\n";
+    std::cout << "Object BVH + BLAS rays:  " << treeMs << " ms (" << NUM_RAYS / (treeMs / 1000.0) << " rays/s)\n";
+    std::cout << "Brute force rays:        " << bruteMs << " ms (" << NUM_RAYS / (bruteMs / 1000.0) << " rays/s)\n";
+    std::cout << "Hits: " << numHits << "/" << NUM_RAYS << ", mismatches against brute force: " << mismatches << "\n";
+}
+
+// Bounding volumes of the scene tiled side by side until there are count objects, without meshes
+static std::vector<Object> TiledObjects(const std::vector<Object>& objects, int count) {
+    AABB sceneBounds = ComputeAABB(objects);
+    glm::vec3 extent = sceneBounds.max - sceneBounds.min;
+    int tilesPerRow = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count) / objects.size())));
+
+    std::vector<Object> tiled(count);
+    for (int i = 0; i < count; ++i) {
+        const Object& src = objects[i % objects.size()];
+        int tile = i / static_cast<int>(objects.size());
+        glm::vec3 offset = extent * glm::vec3(tile % tilesPerRow, 0.0f, tile / tilesPerRow);
+
+        Object& obj = tiled[i];
+        obj.boundingBox = { src.boundingBox.min + offset, src.boundingBox.max + offset };
+        obj.ritterSphere = { src.ritterSphere.center + offset, src.ritterSphere.radius };
+        obj.larssonSphere = { src.larssonSphere.center + offset, src.larssonSphere.radius };
+        obj.pcaSphere = { src.pcaSphere.center + offset, src.pcaSphere.radius };
+    }
+    return tiled;
+}
+
+void ReportBuildTimes(std::vector<Object>& objects) {
+    const int MAX_BOTTOM_UP_OBJECTS = 20000; // The greedy bottom-up builder grows faster than linearly
+
+    std::cout << "\n== Build times (" << objects.size() << " objects) ==\n";
+    std::cout << std::left << std::setw(28) << "Builder" << std::right << std::setw(8) << "Depth"
+        << std::setw(12) << "SAH Cost" << std::setw(12) << "Build ms" << "\n";
+
+    auto printRow = [](const char* name, TreeNode* root, double buildMs) {
+        std::cout << std::left << std::setw(28) << name << std::right << std::setw(8) << TreeDepth(root)
+            << std::fixed << std::setprecision(2) << std::setw(12) << TreeSAHCost(root) << std::setw(12) << buildMs << "\n";
+        };
+
+    SplitMethod savedSplitMethod = currentSplitMethod;
+    bool savedMaxHeight = maxHeight;
+    maxHeight = false;
+    std::vector<Object*> work = ObjectPointers(objects);
+    for (SplitMethod split : { SM_MEDIAN_CENTER, SM_SAH }) {
+        currentSplitMethod = split;
+        auto start = std::chrono::high_resolution_clock::now();
+        NodeArena arena;
+        TreeNode* root = arena.New();
+        TopDownTree(arena, root, work, 0, INT_MAX);
+        double buildMs = MillisecondsSince(start);
+        printRow(split == SM_SAH ? "Top-down SAH" : "Top-down median", root, buildMs);
+    }
+    currentSplitMethod = savedSplitMethod;
+    maxHeight = savedMaxHeight;
+
+    if (objects.size() <= MAX_BOTTOM_UP_OBJECTS) {
+        NodeArena arena;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<TreeNode*> leafNodes = InitializeLeafNodes(arena, objects);
+        TreeNode* root = BottomUpTree(arena, leafNodes);
+        double buildMs = MillisecondsSince(start);
+        printRow("Bottom-up", root, buildMs);
+    }
+    else {
+        std::cout << std::left << std::setw(28) << "Bottom-up" << "skipped above " << MAX_BOTTOM_UP_OBJECTS << " objects\n";
+    }
+
+    for (int bits : { 30, 63 }) {
+        NodeArena arena;
+        auto start = std::chrono::high_resolution_clock::now();
+        TreeNode* root = LBVHTree(arena, objects, bits);
+        double buildMs = MillisecondsSince(start);
+        printRow(bits == 30 ? "LBVH 30-bit" : "LBVH 63-bit", root, buildMs);
+    }
+
+    for (PLOCDistance distance : { PD_SURFACE_AREA, PD_BOUNDING_VOLUME_COST }) {
+        NodeArena arena;
+        auto start = std::chrono::high_resolution_clock::now();
+        TreeNode* root = PLOCTree(arena, objects, PLOC_RADIUS, distance);
+        double buildMs = MillisecondsSince(start);
+        printRow(distance == PD_SURFACE_AREA ? "PLOC surface area" : "PLOC bounding volume cost", root, buildMs);
+    }
+
+    {
+        NodeArena arena;
+        auto start = std::chrono::high_resolution_clock::now();
+        TreeNode* root = InsertionTree(arena, objects);
+        double buildMs = MillisecondsSince(start);
+        printRow("Insertion", root, buildMs);
+    }
+
+    // LBVH scaling on the scene's bounding volumes tiled out to large object counts
+    std::cout << "\nLBVH 63-bit scaling (tiled scene volumes):\n";
+    for (int count : { 10000, 100000, 1000000 }) {
+        std::vector<Object> tiled = TiledObjects(objects, count);
+        NodeArena arena;
+        auto start = std::chrono::high_resolution_clock::now();
+        LBVHTree(arena, tiled, 63);
+        double buildMs = MillisecondsSince(start);
+        std::cout << std::right << std::setw(10) << count << " objects: " << std::fixed << std::setprecision(2) << buildMs << " ms, "
+            << arena.Bytes() / (1024.0 * 1024.0) << " MB of nodes\n";
+    }
+
+    // Radius 0 is the exact greedy result; a radius settles for the best partner within that many grid cells
+    // Adding the last tenth of a scene to a tree of the rest, against building everything again
+    std::cout << "\nInsertion, adding 10% to an existing tree (tiled scene volumes):\n";
+    for (int count : { 10000, 100000 }) {
+        std::vector<Object> tiled = TiledObjects(objects, count);
+        int existing = count - count / 10;
+
+        NodeArena arena;
+        TreeNode* root = InsertionTree(arena, std::vector<Object>(tiled.begin(), tiled.begin() + existing));
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = existing; i < count; ++i) {
+            InsertObject(arena, root, tiled[i]);
+        }
+        double insertMs = MillisecondsSince(start);
+
+        NodeArena rebuildArena;
+        start = std::chrono::high_resolution_clock::now();
+        TreeNode* rebuilt = InsertionTree(rebuildArena, tiled);
+        double rebuildMs = MillisecondsSince(start);
+        std::cout << std::right << std::setw(10) << count << " objects: " << std::fixed << std::setprecision(2) << insertMs
+            << " ms to insert (SAH " << TreeSAHCost(root) << "), " << rebuildMs << " ms to rebuild (SAH " << TreeSAHCost(rebuilt) << ")\n";
+    }
+
+    std::cout << "\nBottom-up scaling by partner search radius (tiled scene volumes, SAH cost / build ms):\n";
+    std::cout << std::right << std::setw(10) << "Objects";
+    for (int radius : { 0, 1, 2 }) {
+        std::cout << std::setw(22) << (radius == 0 ? std::string("Exact") : "Radius " + std::to_string(radius));
+    }
+    std::cout << "\n";
+    for (int count : { 1000, 5000, 10000 }) {
+        std::vector<Object> tiled = TiledObjects(objects, count);
+        std::cout << std::setw(10) << count;
+        for (int radius : { 0, 1, 2 }) {
+            NodeArena arena;
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<TreeNode*> leafNodes = InitializeLeafNodes(arena, tiled);
+            TreeNode* root = BottomUpTree(arena, leafNodes, radius);
+            double buildMs = MillisecondsSince(start);
+            std::cout << std::fixed << std::setprecision(2) << std::setw(12) << TreeSAHCost(root) << std::setw(10) << buildMs;
+        }
+        std::cout << "\n";
+    }
+
+    // Repeated rebuilds: every tree is released with its arena, so memory does not grow
+    const int NUM_REBUILDS = 1000;
+    savedMaxHeight = maxHeight;
+    savedSplitMethod = currentSplitMethod;
+    maxHeight = false;
+    currentSplitMethod = SM_MEDIAN_CENTER;
+    size_t arenaBytes = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_REBUILDS; ++i) {
+        NodeArena arena;
+        TopDownTree(arena, arena.New(), work, 0, INT_MAX);
+        arenaBytes = std::max(arenaBytes, arena.Bytes());
+    }
+    double rebuildMs = MillisecondsSince(start) / NUM_REBUILDS;
+    currentSplitMethod = savedSplitMethod;
+    maxHeight = savedMaxHeight;
+    std::cout << "\nTop-down median rebuilt " << NUM_REBUILDS << " times: " << std::fixed << std::setprecision(3) << rebuildMs
+        << " ms per build, at most " << arenaBytes / 1024 << " KB of nodes live\n";
+}
+
+void ReportTreeletOptimization(std::vector<Object>& objects) {
+    const int NUM_RAYS = 2000;
+    const int MAX_BOTTOM_UP_OBJECTS = 20000;
+    AABB sceneBounds = ComputeAABB(objects);
+    std::vector<Ray> rays = RandomRays(sceneBounds, NUM_RAYS, 4);
+
+    std::cout << "\n== Treelet optimization (" << TRBVH_TREELET_LEAVES << "-leaf treelets, " << NUM_RAYS << " rays) ==\n";
+    std::cout << std::left << std::setw(24) << "Builder" << std::right << std::setw(12) << "SAH Before" << std::setw(12) << "SAH After"
+        << std::setw(14) << "Visits Before" << std::setw(14) << "Visits After" << std::setw(14) << "Rays/s Before"
+        << std::setw(14) << "Rays/s After" << std::setw(12) << "Optimize ms" << "\n";
+
+    // Average node visits and closest-hit throughput over the ray set
+    auto measure = [&](TreeNode* root, double& visits, double& raysPerSecond) {
+        visits = 0.0;
+        for (const auto& ray : rays) visits += RayNodeVisits(root, ray, std::numeric_limits<float>::max());
+        visits /= NUM_RAYS;
+
+        RayHit hit;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto& ray : rays) RayCastTree(root, ray, std::numeric_limits<float>::max(), hit);
+        raysPerSecond = NUM_RAYS / (MillisecondsSince(start) / 1000.0);
+        };
+
+    auto optimizeRow = [&](const char* name, TreeNode* root) {
+        double visitsBefore, visitsAfter, raysBefore, raysAfter;
+        float costBefore = TreeSAHCost(root);
+        measure(root, visitsBefore, raysBefore);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        OptimizeTreelets(root);
+        double optimizeMs = MillisecondsSince(start);
+        measure(root, visitsAfter, raysAfter);
+
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << costBefore << std::setw(12) << TreeSAHCost(root) << std::setprecision(1)
+            << std::setw(14) << visitsBefore << std::setw(14) << visitsAfter << std::setprecision(0)
+            << std::setw(14) << raysBefore << std::setw(14) << raysAfter << std::setprecision(2) << std::setw(12) << optimizeMs << "\n";
+        };
+
+    SplitMethod savedSplitMethod = currentSplitMethod;
+    bool savedMaxHeight = maxHeight;
+    maxHeight = false;
+    std::vector<Object*> work = ObjectPointers(objects);
+    for (SplitMethod split : { SM_MEDIAN_CENTER, SM_MEDIAN_EXTENT, SM_SAH }) {
+        currentSplitMethod = split;
+        NodeArena arena;
+        TreeNode* root = arena.New();
+        TopDownTree(arena, root, work, 0, INT_MAX);
+        optimizeRow(splitMethodNames[split], root);
+    }
+    currentSplitMethod = savedSplitMethod;
+    maxHeight = savedMaxHeight;
+
+    if (objects.size() <= MAX_BOTTOM_UP_OBJECTS) {
+        NodeArena arena;
+        std::vector<TreeNode*> leafNodes = InitializeLeafNodes(arena, objects);
+        optimizeRow("Bottom-up", BottomUpTree(arena, leafNodes));
+    }
+    NodeArena arena;
+    optimizeRow("LBVH 63-bit", LBVHTree(arena, objects, 63));
+}
+
+void ReportPLOC(std::vector<Object>& objects) {
+    std::cout << "\n== PLOC (" << objects.size() << " objects) ==\n";
+    std::cout << std::left << std::setw(10) << "Radius" << std::right << std::setw(16) << "SAH (Area)" << std::setw(12) << "Build ms"
+        << std::setw(16) << "SAH (BV Cost)" << std::setw(12) << "Build ms" << "\n";
+
+    // A wider search finds better partners at a proportionally higher cost per pass
+    for (int radius : { 1, 4, 16, 32 }) {
+        std::cout << std::left << std::setw(10) << radius << std::right;
+        for (PLOCDistance distance : { PD_SURFACE_AREA, PD_BOUNDING_VOLUME_COST }) {
+            NodeArena arena;
+            auto start = std::chrono::high_resolution_clock::now();
+            TreeNode* root = PLOCTree(arena, objects, radius, distance);
+            double buildMs = MillisecondsSince(start);
+            std::cout << std::fixed << std::setprecision(2) << std::setw(16) << TreeSAHCost(root) << std::setw(12) << buildMs;
+        }
+        std::cout << "\n";
+    }
+
+    // Thread scaling on the scene's bounding volumes tiled out to a large object count
+    const int SCALING_OBJECTS = 1000000;
+    std::vector<Object> tiled = TiledObjects(objects, SCALING_OBJECTS);
+    std::cout << "\nPLOC thread scaling (" << SCALING_OBJECTS << " tiled scene volumes, radius " << PLOC_RADIUS << "):\n";
+    int savedLimit = workerThreadLimit;
+    int maxThreads = NumWorkerThreads();
+    double singleThreadMs = 0.0;
+    for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        workerThreadLimit = threads;
+        NodeArena arena;
+        auto start = std::chrono::high_resolution_clock::now();
+        PLOCTree(arena, tiled, PLOC_RADIUS, PD_SURFACE_AREA);
+        double buildMs = MillisecondsSince(start);
+        if (threads == 1) singleThreadMs = buildMs;
+        std::cout << std::right << std::setw(10) << threads << " threads: " << std::fixed << std::setprecision(2) << buildMs
+            << " ms, speedup " << singleThreadMs / buildMs << "x\n";
+        if (threads == maxThreads) break;
+    }
+    workerThreadLimit = savedLimit;
+}
+
+void ReportAAC(std::vector<Object>& objects) {
+    const int NUM_RAYS = 2000;
+    std::cout << "\n== Approximate agglomerative clustering vs greedy bottom-up (tiled scene volumes, " << NUM_RAYS << " rays) ==\n";
+    std::cout << std::left << std::setw(10) << "Objects" << std::setw(14) << "Builder" << std::right << std::setw(12) << "SAH Cost"
+        << std::setw(12) << "Visits" << std::setw(12) << "Build ms" << std::setw(10) << "Speedup" << "\n";
+
+    for (int count : { 1000, 5000, 10000 }) {
+        std::vector<Object> tiled = TiledObjects(objects, count);
+        std::vector<Ray> rays = RandomRays(ComputeAABB(tiled), NUM_RAYS, 5);
+        double greedyMs = 0.0;
+        auto printRow = [&](const char* name, TreeNode* root, double buildMs) {
+            double visits = 0.0;
+            for (const auto& ray : rays) visits += RayNodeVisits(root, ray, std::numeric_limits<float>::max());
+            std::cout << std::left << std::setw(10) << count << std::setw(14) << name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(12) << TreeSAHCost(root) << std::setprecision(1) << std::setw(12) << visits / NUM_RAYS
+                << std::setprecision(2) << std::setw(12) << buildMs << std::setw(9) << greedyMs / buildMs << "x\n";
+            };
+
+        {
+            NodeArena arena;
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<TreeNode*> leafNodes = InitializeLeafNodes(arena, tiled);
+            TreeNode* root = BottomUpTree(arena, leafNodes);
+            greedyMs = MillisecondsSince(start);
+            printRow("Greedy", root, greedyMs);
+        }
+        for (AACMode mode : { AAC_HIGH_QUALITY, AAC_FAST }) {
+            NodeArena arena;
+            auto start = std::chrono::high_resolution_clock::now();
+            TreeNode* root = AACTree(arena, tiled, mode);
+            double buildMs = MillisecondsSince(start);
+            printRow(mode == AAC_FAST ? "AAC fast" : "AAC HQ", root, buildMs);
+        }
+    }
+}
+
+void ReportMergeCosts(std::vector<Object>& objects) {
+    const int NUM_QUERIES = 2000;
+    const int MAX_BOTTOM_UP_OBJECTS = 20000;
+    const char* costNames[] = { "Distance + Volume + Increase", "Surface Area", "Volume" };
+
+    // The scene's volumes as loaded, then shrunk by 10^4 to show which costs depend on the model scale
+    for (float scale : { 1.0f, 0.0001f }) {
+        std::vector<Object> work = TiledObjects(objects, std::min(static_cast<int>(objects.size()), MAX_BOTTOM_UP_OBJECTS));
+        for (Object& obj : work) {
+            obj.boundingBox = { obj.boundingBox.min * scale, obj.boundingBox.max * scale };
+            for (BoundingSphere* sphere : { &obj.ritterSphere, &obj.larssonSphere, &obj.pcaSphere }) {
+                *sphere = { sphere->center * scale, sphere->radius * scale };
+            }
+        }
+        AABB sceneBounds = ComputeAABB(work);
+        std::vector<Ray> rays = RandomRays(sceneBounds, NUM_QUERIES, 6);
+        std::vector<AABB> boxes = RandomBoxes(sceneBounds, NUM_QUERIES, 0.01f, 7);
+
+        std::cout << "\n== Bottom-up merge costs (" << work.size() << " objects, scale " << std::defaultfloat << scale << ", " << NUM_QUERIES << " rays and boxes) ==\n";
+        std::cout << std::left << std::setw(30) << "Merge Cost" << std::right << std::setw(12) << "Build ms" << std::setw(12) << "SAH Cost"
+            << std::setw(8) << "Depth" << std::setw(14) << "Ray Visits" << std::setw(14) << "Box Visits" << "\n";
+
+        for (MergeCostType costType : { MC_COMBINED, MC_SURFACE_AREA, MC_VOLUME }) {
+            NodeArena arena;
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<TreeNode*> leafNodes = InitializeLeafNodes(arena, work);
+            TreeNode* root = BottomUpTree(arena, leafNodes, costType);
+            double buildMs = MillisecondsSince(start);
+
+            double rayVisits = 0.0, boxVisits = 0.0;
+            for (const auto& ray : rays) rayVisits += RayNodeVisits(root, ray, std::numeric_limits<float>::max());
+            for (const auto& box : boxes) boxVisits += OverlapNodeVisits(root, box);
+            std::cout << std::left << std::setw(30) << costNames[costType] << std::right << std::fixed << std::setprecision(2)
+                << std::setw(12) << buildMs << std::setw(12) << TreeSAHCost(root) << std::setw(8) << TreeDepth(root) << std::setprecision(1)
+                << std::setw(14) << rayVisits / NUM_QUERIES << std::setw(14) << boxVisits / NUM_QUERIES << "\n";
+        }
+    }
+
+    // Zero-volume boxes: flat quads stacked at widely spaced heights, so merging two of them
+    // gives a box with volume and the combined cost's relative increase divides by zero
+    const int NUM_QUADS = 40;
+    std::vector<Object> quads(NUM_QUADS);
+    for (int i = 0; i < NUM_QUADS; ++i) {
+        glm::vec3 corner(i % 7 * 3.0f, i / 7 * 3.0f, std::pow(1.5f, static_cast<float>(i)));
+        quads[i].boundingBox = { corner, corner + glm::vec3(2.0f, 2.0f, 0.0f) };
+    }
+    std::cout << "\n== Bottom-up merge costs on " << NUM_QUADS << " flat quads ==\n";
+    std::cout << std::left << std::setw(30) << "Merge Cost" << std::right << std::setw(12) << "SAH Cost" << std::setw(8) << "Depth" << "\n";
+    for (MergeCostType costType : { MC_COMBINED, MC_SURFACE_AREA, MC_VOLUME }) {
+        NodeArena arena;
+        std::vector<TreeNode*> leafNodes = InitializeLeafNodes(arena, quads);
+        TreeNode* root = BottomUpTree(arena, leafNodes, costType);
+        std::cout << std::left << std::setw(30) << costNames[costType] << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << TreeSAHCost(root) << std::setw(8) << TreeDepth(root) << "\n";
+    }
+}
+
+void ReportFlatTraversal(std::vector<Object>& objects) {
+    const int NUM_OBJECTS = 100000;
+    const int NUM_QUERIES = 20000;
+    std::vector<Object> tiled = TiledObjects(objects, NUM_OBJECTS);
+    AABB tiledBounds = ComputeAABB(tiled);
+    std::vector<Ray> rays = RandomRays(tiledBounds, NUM_QUERIES, 8);
+    std::vector<AABB> boxes = RandomBoxes(tiledBounds, NUM_QUERIES, 0.01f, 9);
+
+    // Bytes one step of an AABB traversal brings in: the cache lines holding a TreeNode's box and
+    // child pointers, or one entry of the link and AABB streams
+    const size_t pointerVisitBytes = (offsetof(TreeNode, children) + sizeof(TreeNode::children) + 63) / 64 * 64;
+    const size_t flatVisitBytes = sizeof(FlatLink) + sizeof(AABB);
+
+    std::cout << "\n== Flattened depth-first array vs pointer tree (" << NUM_OBJECTS << " tiled objects, " << NUM_QUERIES << " rays and boxes) ==\n";
+    std::cout << std::left << std::setw(14) << "Tree" << std::setw(10) << "Layout" << std::right << std::setw(12) << "Bytes/Visit" << std::setw(10) << "Node MB"
+        << std::setw(14) << "Ray Visits" << std::setw(14) << "Ray ms" << std::setw(14) << "Box Visits" << std::setw(14) << "Box ms" << "\n";
+
+    auto printRow = [](const char* name, const char* layout, size_t visitBytes, double megabytes, double rayVisits, double rayMs, double boxVisits, double boxMs) {
+        std::cout << std::left << std::setw(14) << name << std::setw(10) << layout << std::right << std::setw(12) << visitBytes
+            << std::fixed << std::setprecision(2) << std::setw(10) << megabytes << std::setprecision(1) << std::setw(14) << rayVisits / NUM_QUERIES << std::setprecision(2)
+            << std::setw(14) << rayMs << std::setprecision(1) << std::setw(14) << boxVisits / NUM_QUERIES << std::setprecision(2) << std::setw(14) << boxMs << "\n";
+        };
+
+    for (int width = 2; width <= BVH_WIDTH; width *= 2) {
+        NodeArena arena;
+        TreeNode* root = LBVHTree(arena, tiled);
+        if (width > 2) {
+            CollapseToWide(root, width);
+        }
+        FlatBVH flat = FlattenBVH(root, tiled);
+        std::string name = "LBVH " + std::to_string(width) + "-wide";
+
+        double rayVisits = 0.0, boxVisits = 0.0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto& ray : rays) rayVisits += RayNodeVisits(root, ray, std::numeric_limits<float>::max());
+        double rayMs = MillisecondsSince(start);
+        start = std::chrono::high_resolution_clock::now();
+        for (const auto& box : boxes) boxVisits += OverlapNodeVisits(root, box);
+        double boxMs = MillisecondsSince(start);
+        printRow(name.c_str(), "Pointer", pointerVisitBytes, CountNodes(root) * sizeof(TreeNode) / 1048576.0, rayVisits, rayMs, boxVisits, boxMs);
+
+        rayVisits = boxVisits = 0.0;
+        start = std::chrono::high_resolution_clock::now();
+        for (const auto& ray : rays) rayVisits += FlatRayNodeVisits(flat, ray, std::numeric_limits<float>::max());
+        rayMs = MillisecondsSince(start);
+        start = std::chrono::high_resolution_clock::now();
+        for (const auto& box : boxes) boxVisits += FlatOverlapNodeVisits(flat, box);
+        boxMs = MillisecondsSince(start);
+        printRow(name.c_str(), "Flat", flatVisitBytes, flat.NodeCount() * flatVisitBytes / 1048576.0, rayVisits, rayMs, boxVisits, boxMs);
+    }
+
+    // Sphere queries walk the link stream and one sphere stream, leaving the boxes and other spheres out of cache
+    {
+        NodeArena arena;
+        FlatBVH flat = FlattenBVH(LBVHTree(arena, tiled), tiled);
+        std::cout << "Sphere queries, " << sizeof(FlatLink) + sizeof(BoundingSphere) << " bytes per visit (a node interleaving every volume would load "
+            << sizeof(FlatLink) + sizeof(AABB) + 3 * sizeof(BoundingSphere) << "):\n";
+        const char* sphereNames[] = { "Ritter", "Larsson", "PCA" };
+        for (BoundingVolumeType bvType : { BVT_RITTER_SPHERE, BVT_LARSSON_SPHERE, BVT_PCA_SPHERE }) {
+            double visits = 0.0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const auto& box : boxes) {
+                BoundingSphere sphere = { (box.min + box.max) * 0.5f, glm::length(box.max - box.min) * 0.5f };
+                visits += FlatOverlapNodeVisits(flat, sphere, bvType);
+            }
+            double sphereMs = MillisecondsSince(start);
+            std::cout << "  " << std::left << std::setw(10) << sphereNames[bvType - BVT_RITTER_SPHERE] << std::right << std::fixed << std::setprecision(1)
+                << visits / NUM_QUERIES << " visits, " << std::setprecision(2) << sphereMs << " ms\n";
+        }
+    }
+
+    // Closest hits through each object's triangle BVH, which both layouts must agree on
+    AABB sceneBounds = ComputeAABB(objects);
+    rays = RandomRays(sceneBounds, NUM_QUERIES / 10, 10);
+    NodeArena arena;
+    TreeNode* root = LBVHTree(arena, objects);
+    FlatBVH flat = FlattenBVH(root, objects);
+
+    std::vector<RayHit> hits(rays.size());
+    std::vector<bool> found(rays.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < rays.size(); ++i) {
+        found[i] = RayCastTree(root, rays[i], std::numeric_limits<float>::max(), hits[i]);
+    }
+    double pointerMs = MillisecondsSince(start);
+
+    int mismatches = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < rays.size(); ++i) {
+        RayHit hit;
+        bool flatFound = FlatRayCast(flat, rays[i], std::numeric_limits<float>::max(), hit);
+        if (flatFound != found[i] || (flatFound && hit.t != hits[i].t)) {
+            mismatches++;
+        }
+    }
+    double flatMs = MillisecondsSince(start);
+    std::cout << "Closest hit on the scene's triangles, " << rays.size() << " rays: " << std::fixed << std::setprecision(2)
+        << pointerMs << " ms pointer, " << flatMs << " ms flat, " << mismatches << " mismatches\n";
+}
+
+void ReportQuantizedNodes(std::vector<Object>& objects) {
+    const int NUM_QUERIES = 20000;
+    std::cout << "\n== Quantized 4-wide nodes vs flat array (tiled scene volumes, " << NUM_QUERIES << " rays and boxes) ==\n";
+    std::cout << std::left << std::setw(10) << "Objects" << std::setw(16) << "Layout" << std::right << std::setw(10) << "Nodes"
+        << std::setw(10) << "MB" << std::setw(12) << "Nodes/MB" << std::setw(12) << "Rays/s" << std::setw(12) << "Boxes/s" << "\n";
+
+    for (int count : { 100000, 1000000 }) {
+        std::vector<Object> tiled = TiledObjects(objects, count);
+        AABB tiledBounds = ComputeAABB(tiled);
+        std::vector<Ray> rays = RandomRays(tiledBounds, NUM_QUERIES, 11);
+        std::vector<AABB> boxes = RandomBoxes(tiledBounds, NUM_QUERIES, 0.01f, 12);
+
+        NodeArena arena;
+        TreeNode* root = LBVHTree(arena, tiled);
+        QBVH qbvh = BuildQBVH(root, tiled);
+        CollapseToWide(root, std::min(QBVH_WIDTH, BVH_WIDTH));
+        FlatBVH flat = FlattenBVH(root, tiled);
+        arena.Release();
+
+        // Queries on volumes without meshes find nothing, so the time is all traversal
+        auto printRow = [&](const char* layout, size_t nodes, size_t bytes, auto rayCast, auto overlap) {
+            RayHit hit;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const auto& ray : rays) rayCast(ray, hit);
+            double rayMs = MillisecondsSince(start);
+
+            std::vector<const Object*> results;
+            start = std::chrono::high_resolution_clock::now();
+            for (const auto& box : boxes) overlap(box, results);
+            double boxMs = MillisecondsSince(start);
+
+            double megabytes = bytes / 1048576.0;
+            std::cout << std::left << std::setw(10) << count << std::setw(16) << layout << std::right << std::setw(10) << nodes
+                << std::fixed << std::setprecision(2) << std::setw(10) << megabytes << std::setprecision(0) << std::setw(12) << nodes / megabytes
+                << std::setw(12) << NUM_QUERIES / (rayMs / 1000.0) << std::setw(12) << NUM_QUERIES / (boxMs / 1000.0) << "\n";
+            };
+
+        printRow("Flat", flat.NodeCount(), flat.NodeCount() * (sizeof(FlatLink) + sizeof(AABB)) + flat.primitives.size() * sizeof(int),
+            [&](const Ray& ray, RayHit& hit) { FlatRayCast(flat, ray, std::numeric_limits<float>::max(), hit); },
+            [&](const AABB& box, std::vector<const Object*>& results) { FlatOverlap(flat, box, results); });
+        printRow("Quantized", qbvh.nodes.size(), qbvh.nodes.size() * sizeof(QBVHNode) + qbvh.primitives.size() * sizeof(int),
+            [&](const Ray& ray, RayHit& hit) { QBVHRayCast(qbvh, ray, std::numeric_limits<float>::max(), hit); },
+            [&](const AABB& box, std::vector<const Object*>& results) { QBVHOverlap(qbvh, box, results); });
+    }
+}
+
+void ReportChildTests(std::vector<Object>& objects) {
+    const int NUM_OBJECTS = 100000;
+    const int NUM_QUERIES = 64;
+    std::cout << "\n== SIMD child box tests (" << BVH_WIDTH << "-wide nodes of " << NUM_OBJECTS << " tiled scene volumes, "
+        << NUM_QUERIES << " queries of each kind against every node) ==\n";
+    std::cout << "CPU supports " << ChildTests(DetectSimdLevel()).name << ", traversal uses " << ActiveChildTests().name << "\n";
+
+    std::vector<Object> tiled = TiledObjects(objects, NUM_OBJECTS);
+    AABB bounds = ComputeAABB(tiled);
+    NodeArena arena;
+    TreeNode* root = LBVHTree(arena, tiled);
+    CollapseToWide(root, BVH_WIDTH);
+
+    std::vector<const TreeNode*> nodes;
+    std::vector<const TreeNode*> stack = { root };
+    while (!stack.empty()) {
+        const TreeNode* node = stack.back();
+        stack.pop_back();
+        if (node->type == LEAF) continue;
+        nodes.push_back(node);
+        for (int i = 0; i < node->numChildren; ++i) stack.push_back(node->children[i]);
+    }
+
+    std::vector<Ray> rays = RandomRays(bounds, NUM_QUERIES, 13);
+    std::vector<AABB> boxes = RandomBoxes(bounds, NUM_QUERIES, 0.05f, 14);
+    std::vector<BoundingSphere> spheres;
+    std::vector<Frustum> frustums;
+    float diagonal = glm::length(bounds.max - bounds.min);
+    for (int i = 0; i < NUM_QUERIES; ++i) {
+        spheres.push_back({ (boxes[i].min + boxes[i].max) * 0.5f, diagonal * 0.025f });
+        glm::mat4 view = glm::lookAt(rays[i].start, rays[i].start + rays[i].direction, glm::vec3(0.0f, 1.0f, 0.0f));
+        frustums.push_back(ExtractFrustum(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.01f * diagonal, diagonal) * view));
+    }
+
+    std::cout << std::left << std::setw(10) << "Kernels" << std::right << std::setw(8) << "Lanes" << std::setw(12) << "Ray M/s"
+        << std::setw(12) << "Sphere M/s" << std::setw(12) << "Box M/s" << std::setw(12) << "Frustum M/s" << std::setw(12) << "Mismatches" << "\n";
+
+    // Every level's masks and hit order are checked against the scalar kernels
+    const ChildTestKernels& reference = ChildTests(SIMD_SCALAR);
+    double childTests = static_cast<double>(nodes.size()) * NUM_QUERIES * BVH_WIDTH;
+    for (SimdLevel level : { SIMD_SCALAR, SIMD_SSE, SIMD_AVX2 }) {
+        const ChildTestKernels& kernels = ChildTests(level);
+        if (level != SIMD_SCALAR && &kernels == &ChildTests(static_cast<SimdLevel>(level - 1))) continue;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto& ray : rays) {
+            glm::vec3 invDir = 1.0f / ray.direction;
+            for (const TreeNode* node : nodes) {
+                ChildHits hits;
+                kernels.ray(*node, ray, invDir, std::numeric_limits<float>::max(), hits);
+            }
+        }
+        double rayMs = MillisecondsSince(start);
+        start = std::chrono::high_resolution_clock::now();
+        for (const auto& sphere : spheres) {
+            for (const TreeNode* node : nodes) kernels.sphere(*node, sphere);
+        }
+        double sphereMs = MillisecondsSince(start);
+        start = std::chrono::high_resolution_clock::now();
+        for (const auto& box : boxes) {
+            for (const TreeNode* node : nodes) kernels.box(*node, box);
+        }
+        double boxMs = MillisecondsSince(start);
+        start = std::chrono::high_resolution_clock::now();
+        for (const auto& frustum : frustums) {
+            for (const TreeNode* node : nodes) kernels.frustum(*node, frustum);
+        }
+        double frustumMs = MillisecondsSince(start);
+
+        int mismatches = 0;
+        for (int q = 0; q < NUM_QUERIES; ++q) {
+            glm::vec3 invDir = 1.0f / rays[q].direction;
+            for (const TreeNode* node : nodes) {
+                ChildHits hits, expected;
+                kernels.ray(*node, rays[q], invDir, std::numeric_limits<float>::max(), hits);
+                reference.ray(*node, rays[q], invDir, std::numeric_limits<float>::max(), expected);
+                bool same = hits.mask == expected.mask && hits.count == expected.count;
+                for (int i = 0; same && i < hits.count; ++i) {
+                    same = hits.order[i] == expected.order[i] && hits.tEntry[i] == expected.tEntry[i];
+                }
+                same = same && kernels.sphere(*node, spheres[q]) == reference.sphere(*node, spheres[q]);
+                same = same && kernels.box(*node, boxes[q]) == reference.box(*node, boxes[q]);
+                same = same && kernels.frustum(*node, frustums[q]) == reference.frustum(*node, frustums[q]);
+                if (!same) mismatches++;
+            }
+        }
+
+        std::cout << std::left << std::setw(10) << kernels.name << std::right << std::setw(8) << kernels.lanes << std::fixed << std::setprecision(1)
+            << std::setw(12) << childTests / (rayMs * 1000.0) << std::setw(12) << childTests / (sphereMs * 1000.0)
+            << std::setw(12) << childTests / (boxMs * 1000.0) << std::setw(12) << childTests / (frustumMs * 1000.0)
+            << std::setw(12) << mismatches << "\n";
+    }
+
+    // The tree queries against testing every object
+    int wrongQueries = 0;
+    for (int q = 0; q < NUM_QUERIES; ++q) {
+        std::vector<const Object*> sphereResults, frustumResults;
+        SphereOverlapTree(root, spheres[q], sphereResults);
+        FrustumCullTree(root, frustums[q], frustumResults);
+        size_t sphereExpected = 0, frustumExpected = 0;
+        for (const auto& obj : tiled) {
+            sphereExpected += SphereAABBOverlap(spheres[q], obj.boundingBox);
+            frustumExpected += AABBInFrustum(frustums[q], obj.boundingBox);
+        }
+        if (sphereResults.size() != sphereExpected || frustumResults.size() != frustumExpected) wrongQueries++;
+    }
+    std::cout << "Sphere and frustum tree queries differing from a test of every object: " << wrongQueries << " of " << NUM_QUERIES << "\n";
+}
+
+void ReportSerialization(std::vector<Object>& objects) {
+    const int NUM_QUERIES = 2000;
+    std::cout << "\n== Saved trees mapped back from disk (" << objects.size() << " objects, " << NUM_QUERIES << " rays and boxes compared) ==\n";
+    std::cout << std::left << std::setw(12) << "Method" << std::right << std::setw(12) << "Build ms" << std::setw(10) << "Save ms"
+        << std::setw(10) << "Load ms" << std::setw(10) << "MB" << std::setw(12) << "Mismatches" << "\n";
+
+    BVHFileStore store;
+    store.directory = (std::filesystem::temp_directory_path() / "bvhreport").string();
+    std::error_code error;
+    std::filesystem::create_directories(store.directory, error);
+    auto start = std::chrono::high_resolution_clock::now();
+    store.sceneHash = SceneHash(objects);
+    std::cout << "Scene hash " << std::hex << store.sceneHash << std::dec << " in " << std::fixed << std::setprecision(2) << MillisecondsSince(start) << " ms\n";
+
+    AABB bounds = ComputeAABB(objects);
+    std::vector<Ray> rays = RandomRays(bounds, NUM_QUERIES, 15);
+    std::vector<AABB> boxes = RandomBoxes(bounds, NUM_QUERIES, 0.02f, 16);
+    const char* names[] = { "Top-down", "Bottom-up", "LBVH", "PLOC", "AAC", "Insertion" };
+    for (ConstructionMethod method : { CM_TOP_DOWN, CM_BOTTOM_UP, CM_LBVH, CM_PLOC, CM_AAC, CM_INSERTION }) {
+        BVHConfig config;
+        config.method = method;
+        if (method == CM_TOP_DOWN) config.splitMethod = SM_SAH;
+
+        start = std::chrono::high_resolution_clock::now();
+        CachedBVH built = BuildCachedBVH(config, objects);
+        double buildMs = MillisecondsSince(start);
+
+        std::string path = BVHFilePath(store, config);
+        start = std::chrono::high_resolution_clock::now();
+        bool saved = SaveBVH(path, config, built.flat, objects, store.sceneHash);
+        double saveMs = MillisecondsSince(start);
+
+        FlatBVH loaded;
+        start = std::chrono::high_resolution_clock::now();
+        bool mapped = saved && LoadBVH(path, config, objects, store.sceneHash, loaded);
+        double loadMs = MillisecondsSince(start);
+        if (!mapped) {
+            std::cout << std::left << std::setw(12) << names[method] << std::right << std::setw(12) << buildMs << "  not " << (saved ? "loaded" : "saved") << "\n";
+            continue;
+        }
+
+        // Same nodes visited and the same objects found
+        int mismatches = 0;
+        for (int i = 0; i < NUM_QUERIES; ++i) {
+            RayHit builtHit, loadedHit;
+            bool builtFound = FlatRayCast(built.flat, rays[i], std::numeric_limits<float>::max(), builtHit);
+            bool loadedFound = FlatRayCast(loaded, rays[i], std::numeric_limits<float>::max(), loadedHit);
+            std::vector<const Object*> builtResults, loadedResults;
+            FlatOverlap(built.flat, boxes[i], builtResults);
+            FlatOverlap(loaded, boxes[i], loadedResults);
+            if (builtFound != loadedFound || (builtFound && (builtHit.t != loadedHit.t || builtHit.object != loadedHit.object)) || builtResults != loadedResults
+                || FlatRayNodeVisits(built.flat, rays[i], std::numeric_limits<float>::max()) != FlatRayNodeVisits(loaded, rays[i], std::numeric_limits<float>::max())) {
+                mismatches++;
+            }
+        }
+
+        std::cout << std::left << std::setw(12) << names[method] << std::right << std::setprecision(2) << std::setw(12) << buildMs
+            << std::setw(10) << saveMs << std::setw(10) << loadMs << std::setw(10) << loaded.Bytes() / 1048576.0 << std::setw(12) << mismatches << "\n";
+    }
+
+    // A different scene must not pick up these files
+    BVHConfig config;
+    config.method = CM_LBVH;
+    FlatBVH stale;
+    bool rejected = !LoadBVH(BVHFilePath(store, config), config, objects, store.sceneHash + 1, stale);
+    std::cout << "File for another scene " << (rejected ? "rejected" : "ACCEPTED") << "\n";
+    std::filesystem::remove_all(store.directory, error);
+}
+
+void ReportNodeOrder(std::vector<Object>& objects) {
+    const int NUM_QUERIES = 20000;
+    std::cout << "\n== Node order (LBVH over tiled scene volumes, " << NUM_QUERIES << " rays and boxes, "
+        << CACHE_MODEL_BYTES / 1024 << " KB " << CACHE_MODEL_WAYS << "-way cache model) ==\n";
+    std::cout << std::left << std::setw(10) << "Objects" << std::setw(20) << "Layout" << std::right << std::setw(14) << "Ray misses"
+        << std::setw(14) << "Box misses" << std::setw(10) << "Ray ms" << std::setw(10) << "Box ms" << "\n";
+
+    for (int count : { 100000, 1000000 }) {
+        std::vector<Object> tiled = TiledObjects(objects, count);
+        AABB tiledBounds = ComputeAABB(tiled);
+        std::vector<Ray> rays = RandomRays(tiledBounds, NUM_QUERIES, 17);
+        std::vector<AABB> boxes = RandomBoxes(tiledBounds, NUM_QUERIES, 0.01f, 18);
+
+        NodeArena arena;
+        FlatBVH flat = FlattenBVH(LBVHTree(arena, tiled), tiled);
+        arena.Release();
+
+        // Misses per query with the cache kept warm from one query to the next, as in a batch
+        auto printRow = [&](const char* layout, const auto& bvh, auto rayCast, auto overlap) {
+            CacheModel cache;
+            for (const auto& ray : rays) ModelRayTraversal(bvh, ray, std::numeric_limits<float>::max(), cache);
+            double rayMisses = static_cast<double>(cache.Misses()) / NUM_QUERIES;
+            cache.Clear();
+            for (const auto& box : boxes) ModelOverlapTraversal(bvh, box, cache);
+            double boxMisses = static_cast<double>(cache.Misses()) / NUM_QUERIES;
+
+            RayHit hit;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const auto& ray : rays) rayCast(ray, hit);
+            double rayMs = MillisecondsSince(start);
+            std::vector<const Object*> results;
+            start = std::chrono::high_resolution_clock::now();
+            for (const auto& box : boxes) overlap(box, results);
+            double boxMs = MillisecondsSince(start);
+
+            std::cout << std::left << std::setw(10) << count << std::setw(20) << layout << std::right << std::fixed << std::setprecision(1)
+                << std::setw(14) << rayMisses << std::setw(14) << boxMisses << std::setprecision(2) << std::setw(10) << rayMs << std::setw(10) << boxMs << "\n";
+            };
+
+        printRow("Depth-first (skip)", flat,
+            [&](const Ray& ray, RayHit& hit) { FlatRayCast(flat, ray, std::numeric_limits<float>::max(), hit); },
+            [&](const AABB& box, std::vector<const Object*>& results) { FlatOverlap(flat, box, results); });
+
+        const char* orderNames[] = { "Depth-first", "Breadth-first", "van Emde Boas" };
+        for (NodeOrder order : { NO_DEPTH_FIRST, NO_BREADTH_FIRST, NO_VAN_EMDE_BOAS }) {
+            OrderedBVH ordered = OrderNodes(flat, order);
+            printRow(orderNames[order], ordered,
+                [&](const Ray& ray, RayHit& hit) { OrderedRayCast(ordered, ray, std::numeric_limits<float>::max(), hit); },
+                [&](const AABB& box, std::vector<const Object*>& results) { OrderedOverlap(ordered, box, results); });
+        }
+    }
+}
+
+void ReportRayQueries(std::vector<Object>& objects) {
+    const int NUM_RAYS = 20000;
+    std::cout << "\n== Ray queries through each object's triangle BVH (" << objects.size() << " objects, " << NUM_RAYS << " rays) ==\n";
+    std::cout << std::left << std::setw(12) << "Tree" << std::setw(28) << "Query" << std::right << std::setw(12) << "Rays/s"
+        << std::setw(10) << "Hits" << std::setw(12) << "Mismatches" << "\n";
+
+    AABB bounds = ComputeAABB(objects);
+    std::vector<Ray> rays = RandomRays(bounds, NUM_RAYS, 19);
+    const char* names[] = { "Top-down", "Bottom-up", "LBVH", "PLOC", "AAC", "Insertion" };
+    for (ConstructionMethod method : { CM_TOP_DOWN, CM_LBVH, CM_PLOC }) {
+        BVHConfig config;
+        config.method = method;
+        if (method == CM_TOP_DOWN) config.splitMethod = SM_SAH;
+        CachedBVH bvh = BuildCachedBVH(config, objects);
+
+        // Reference: every node whose parent the ray enters, in storage order
+        std::vector<RayHit> expected(rays.size());
+        std::vector<bool> expectedFound(rays.size());
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < rays.size(); ++i) {
+            expectedFound[i] = FlatRayCast(bvh.flat, rays[i], std::numeric_limits<float>::max(), expected[i]);
+        }
+        double referenceMs = MillisecondsSince(start);
+
+        auto printRow = [&](const std::string& query, double ms, int hits, int mismatches) {
+            std::cout << std::left << std::setw(12) << names[method] << std::setw(28) << query << std::right << std::fixed << std::setprecision(0)
+                << std::setw(12) << NUM_RAYS / (ms / 1000.0) << std::setw(10) << hits << std::setw(12) << mismatches << "\n";
+            };
+        int expectedHits = static_cast<int>(std::count(expectedFound.begin(), expectedFound.end(), true));
+        printRow("Storage order (FlatRayCast)", referenceMs, expectedHits, 0);
+
+        const char* volumeNames[] = { "", "AABB", "Ritter", "Larsson", "PCA" };
+        for (BoundingVolumeType bvType : { BVT_AABB, BVT_RITTER_SPHERE, BVT_LARSSON_SPHERE, BVT_PCA_SPHERE }) {
+            int hits = 0, mismatches = 0;
+            start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < rays.size(); ++i) {
+                RayHit hit;
+                bool found = RayCast(bvh.flat, rays[i], std::numeric_limits<float>::max(), hit, bvType);
+                hits += found;
+                if (found != expectedFound[i] || (found && hit.t != expected[i].t)) mismatches++;
+            }
+            printRow(std::string("RayCast, ") + volumeNames[bvType], MillisecondsSince(start), hits, mismatches);
+        }
+
+        // Occluded up to the closest hit's distance, and never before half of it
+        int hits = 0, mismatches = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < rays.size(); ++i) {
+            bool occluded = RayOccluded(bvh.flat, rays[i], std::numeric_limits<float>::max());
+            hits += occluded;
+            if (occluded != expectedFound[i]) mismatches++;
+        }
+        double occludedMs = MillisecondsSince(start);
+        for (size_t i = 0; i < rays.size(); ++i) {
+            if (expectedFound[i] && RayOccluded(bvh.flat, rays[i], expected[i].t * 0.5f)) mismatches++;
+        }
+        printRow("RayOccluded, AABB", occludedMs, hits, mismatches);
+    }
+}
+
+// Camera rays for a width x height image of bounds, seen from the front and above, in 2x2
+// pixel blocks so every four consecutive rays belong to neighbouring pixels
+static std::vector<Ray> CameraGridRays(const AABB& bounds, int width, int height) {
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+    float tanHalfFov = std::tan(glm::radians(45.0f) * 0.5f);
+    glm::vec3 eye = center + glm::normalize(glm::vec3(0.0f, 0.25f, 1.0f)) * (radius / tanHalfFov);
+    glm::vec3 front = glm::normalize(center - eye);
+    glm::vec3 right = glm::normalize(glm::cross(front, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 up = glm::cross(right, front);
+    float aspect = static_cast<float>(width) / height;
+
+    std::vector<Ray> rays;
+    rays.reserve(static_cast<size_t>(width) * height);
+    for (int blockY = 0; blockY < height; blockY += 2) {
+        for (int blockX = 0; blockX < width; blockX += 2) {
+            for (int y = blockY; y < std::min(blockY + 2, height); ++y) {
+                for (int x = blockX; x < std::min(blockX + 2, width); ++x) {
+                    float px = ((x + 0.5f) / width * 2.0f - 1.0f) * tanHalfFov * aspect;
+                    float py = (1.0f - (y + 0.5f) / height * 2.0f) * tanHalfFov;
+                    rays.push_back({ eye, glm::normalize(front + right * px + up * py) });
+                }
+            }
+        }
+    }
+    return rays;
+}
+
+void ReportRayPackets(std::vector<Object>& objects) {
+    const int WIDTH = 1920, HEIGHT = 1080;
+    std::cout << "\n== Packets of " << RAY_PACKET_SIZE << " rays over a " << WIDTH << "x" << HEIGHT << " camera grid (" << objects.size() << " objects) ==\n";
+    std::cout << std::left << std::setw(12) << "Tree" << std::setw(28) << "Query" << std::right << std::setw(12) << "Rays/s"
+        << std::setw(10) << "Hits" << std::setw(12) << "Mismatches" << "\n";
+
+    std::vector<Ray> rays = CameraGridRays(ComputeAABB(objects), WIDTH, HEIGHT);
+    // The same rays in random order, so packets are rarely coherent
+    std::vector<Ray> shuffled = rays;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(23));
+    const char* names[] = { "Top-down", "Bottom-up", "LBVH", "PLOC", "AAC", "Insertion" };
+    for (ConstructionMethod method : { CM_TOP_DOWN, CM_PLOC }) {
+        BVHConfig config;
+        config.method = method;
+        if (method == CM_TOP_DOWN) config.splitMethod = SM_SAH;
+        CachedBVH bvh = BuildCachedBVH(config, objects);
+
+        auto printRow = [&](const std::string& query, double ms, int hits, int mismatches) {
+            std::cout << std::left << std::setw(12) << names[method] << std::setw(28) << query << std::right << std::fixed << std::setprecision(0)
+                << std::setw(12) << rays.size() / (ms / 1000.0) << std::setw(10) << hits << std::setw(12) << mismatches << "\n";
+            };
+        auto countHits = [](const std::vector<RayHit>& hits) {
+            return static_cast<int>(std::count_if(hits.begin(), hits.end(), [](const RayHit& hit) { return hit.object != nullptr; }));
+            };
+        // Hits agree when both miss or both stop at the same distance
+        auto countMismatches = [](const std::vector<RayHit>& hits, const std::vector<RayHit>& expected) {
+            int mismatches = 0;
+            for (size_t i = 0; i < hits.size(); ++i) {
+                if ((hits[i].object != nullptr) != (expected[i].object != nullptr) || (hits[i].object && hits[i].t != expected[i].t)) mismatches++;
+            }
+            return mismatches;
+            };
+
+        for (const auto* batch : { &rays, &shuffled }) {
+            const char* order = batch == &rays ? "grid" : "shuffled";
+            std::vector<RayHit> expected(batch->size());
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < batch->size(); ++i) {
+                if (!RayCast(bvh.flat, (*batch)[i], std::numeric_limits<float>::max(), expected[i])) expected[i].object = nullptr;
+            }
+            printRow(std::string("RayCast, ") + order, MillisecondsSince(start), countHits(expected), 0);
+
+            std::vector<RayHit> hits(batch->size());
+            start = std::chrono::high_resolution_clock::now();
+            RayCastPackets(bvh.flat, *batch, std::numeric_limits<float>::max(), hits);
+            printRow(std::string("RayCastPackets, ") + order, MillisecondsSince(start), countHits(hits), countMismatches(hits, expected));
+        }
+    }
+}
+
+void ReportBatchQueries(std::vector<Object>& objects) {
+    const int NUM_RAYS = 500000, NUM_BOXES = 200000;
+    std::cout << "\n== Batch queries across worker threads (" << objects.size() << " objects, " << NUM_RAYS << " rays, " << NUM_BOXES << " boxes) ==\n";
+    std::cout << std::right << std::setw(8) << "Threads" << std::setw(14) << "Cast rays/s" << std::setw(14) << "Occluded/s"
+        << std::setw(14) << "Boxes/s" << std::setw(10) << "Speedup" << std::setw(12) << "Mismatches" << "\n";
+
+    BVHConfig config;
+    config.method = CM_PLOC;
+    CachedBVH bvh = BuildCachedBVH(config, objects);
+    AABB bounds = ComputeAABB(objects);
+    std::vector<Ray> rays = RandomRays(bounds, NUM_RAYS, 29);
+    std::vector<AABB> boxes = RandomBoxes(bounds, NUM_BOXES, 0.01f, 31);
+    const float tMax = std::numeric_limits<float>::max();
+
+    // Reference: one query after another on this thread, in the order given
+    std::vector<RayHit> expectedHits(rays.size());
+    std::vector<uint8_t> expectedOccluded(rays.size());
+    std::vector<int> expectedCounts(boxes.size());
+    std::vector<const Object*> found;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < rays.size(); ++i) {
+        if (!RayCast(bvh.flat, rays[i], tMax, expectedHits[i])) expectedHits[i].object = nullptr;
+    }
+    double castMs = MillisecondsSince(start);
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < rays.size(); ++i) {
+        expectedOccluded[i] = RayOccluded(bvh.flat, rays[i], tMax);
+    }
+    double occludedMs = MillisecondsSince(start);
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        found.clear();
+        FlatOverlap(bvh.flat, boxes[i], found);
+        expectedCounts[i] = static_cast<int>(found.size());
+    }
+    double boxesMs = MillisecondsSince(start);
+    std::cout << std::setw(8) << "serial" << std::fixed << std::setprecision(0) << std::setw(14) << NUM_RAYS / (castMs / 1000.0)
+        << std::setw(14) << NUM_RAYS / (occludedMs / 1000.0) << std::setw(14) << NUM_BOXES / (boxesMs / 1000.0) << "\n";
+
+    int savedLimit = workerThreadLimit;
+    int maxThreads = NumWorkerThreads();
+    double singleThreadMs = 0.0;
+    std::vector<RayHit> hits(rays.size());
+    std::vector<uint8_t> occluded(rays.size());
+    std::vector<int> counts(boxes.size());
+    for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        workerThreadLimit = threads;
+        start = std::chrono::high_resolution_clock::now();
+        BatchRayCast(bvh.flat, rays, tMax, hits);
+        castMs = MillisecondsSince(start);
+        start = std::chrono::high_resolution_clock::now();
+        BatchRayOccluded(bvh.flat, rays, tMax, occluded);
+        occludedMs = MillisecondsSince(start);
+        start = std::chrono::high_resolution_clock::now();
+        BatchOverlap(bvh.flat, boxes, counts);
+        boxesMs = MillisecondsSince(start);
+
+        int mismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            if (hits[i].object != expectedHits[i].object || (hits[i].object && hits[i].t != expectedHits[i].t)) mismatches++;
+            if (occluded[i] != expectedOccluded[i]) mismatches++;
+        }
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            if (counts[i] != expectedCounts[i]) mismatches++;
+        }
+
+        double totalMs = castMs + occludedMs + boxesMs;
+        if (threads == 1) singleThreadMs = totalMs;
+        std::cout << std::setw(8) << threads << std::setprecision(0) << std::setw(14) << NUM_RAYS / (castMs / 1000.0)
+            << std::setw(14) << NUM_RAYS / (occludedMs / 1000.0) << std::setw(14) << NUM_BOXES / (boxesMs / 1000.0)
+            << std::setprecision(2) << std::setw(9) << singleThreadMs / totalMs << "x" << std::setw(12) << mismatches << "\n";
+        if (threads == maxThreads) break;
+    }
+    workerThreadLimit = savedLimit;
+}
+
+void ReportFrustumCulling(std::vector<Object>& objects) {
+    const int REPEATS = 100;
+    std::cout << "\n== Frustum culling for the draw loop (" << objects.size() << " objects, ms per frame over " << REPEATS << " frames) ==\n";
+    std::cout << std::left << std::setw(12) << "Tree" << std::setw(14) << "View" << std::right << std::setw(12) << "Draw calls"
+        << std::setw(10) << "Visible" << std::setw(14) << "Nodes tested" << std::setw(12) << "Per-object" << std::setw(10) << "BVH"
+        << std::setw(12) << "Mismatches" << "\n";
+
+    // The draw loop's projection and model scale; the views look from the scene's center
+    // along each horizontal axis, and at the whole scene from outside it
+    AABB bounds = ComputeAABB(objects);
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f * 0.0001f;
+    float radius = glm::length(bounds.max - bounds.min) * 0.5f * 0.0001f;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.1f, 100.0f);
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.0001f, 0.0001f, 0.0001f));
+    struct View {
+        const char* name;
+        glm::vec3 eye;
+        glm::vec3 target;
+    };
+    View views[] = {
+        { "Overview", center + glm::normalize(glm::vec3(0.0f, 0.25f, 1.0f)) * std::min(radius * 2.5f, 50.0f), center },
+        { "Center +X", center, center + glm::vec3(1.0f, 0.0f, 0.0f) },
+        { "Center -X", center, center - glm::vec3(1.0f, 0.0f, 0.0f) },
+        { "Center +Z", center, center + glm::vec3(0.0f, 0.0f, 1.0f) },
+        { "Center -Z", center, center - glm::vec3(0.0f, 0.0f, 1.0f) },
+    };
+
+    const char* names[] = { "Top-down", "Bottom-up", "LBVH", "PLOC", "AAC", "Insertion" };
+    for (ConstructionMethod method : { CM_TOP_DOWN, CM_PLOC }) {
+        BVHConfig config;
+        config.method = method;
+        if (method == CM_TOP_DOWN) config.splitMethod = SM_SAH;
+        CachedBVH bvh = BuildCachedBVH(config, objects);
+
+        for (const View& view : views) {
+            Frustum frustum = ExtractFrustum(projection * glm::lookAt(view.eye, view.target, glm::vec3(0.0f, 1.0f, 0.0f)) * model);
+
+            // Reference: every object's box tested, as a loop over the draw list would
+            std::vector<int> expected;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < REPEATS; ++r) {
+                expected.clear();
+                for (int i = 0; i < static_cast<int>(objects.size()); ++i) {
+                    if (AABBInFrustum(frustum, objects[i].boundingBox)) expected.push_back(i);
+                }
+            }
+            double perObjectMs = MillisecondsSince(start) / REPEATS;
+
+            std::vector<int> visible;
+            int nodesTested = 0;
+            start = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < REPEATS; ++r) {
+                visible.clear();
+                nodesTested = FlatFrustumCull(bvh.flat, frustum, visible);
+            }
+            double bvhMs = MillisecondsSince(start) / REPEATS;
+
+            // Both lists index the scene; the tree finds them in its own order
+            std::vector<int> found = visible;
+            std::sort(found.begin(), found.end());
+            std::vector<int> different;
+            std::set_symmetric_difference(expected.begin(), expected.end(), found.begin(), found.end(), std::back_inserter(different));
+            int mismatches = static_cast<int>(different.size());
+
+            std::cout << std::left << std::setw(12) << names[method] << std::setw(14) << view.name << std::right << std::setw(12) << visible.size()
+                << std::fixed << std::setprecision(1) << std::setw(9) << 100.0 * visible.size() / objects.size() << "%"
+                << std::setw(14) << nodesTested << std::setprecision(3) << std::setw(12) << perObjectMs << std::setw(10) << bvhMs
+                << std::setw(12) << mismatches << "\n";
+        }
+    }
+}
+
+void RunReports(std::vector<Object>& objects) {
+    ReportAxisMethods(objects);
+    ReportSpatialSplits(objects);
+    ReportTriangleBLAS(objects);
+    ReportBuildTimes(objects);
+    ReportTreeletOptimization(objects);
+    ReportPLOC(objects);
+    ReportAAC(objects);
+    ReportMergeCosts(objects);
+    ReportFlatTraversal(objects);
+    ReportQuantizedNodes(objects);
+    ReportChildTests(objects);
+    ReportSerialization(objects);
+    ReportNodeOrder(objects);
+    ReportRayQueries(objects);
+    ReportRayPackets(objects);
+    ReportBatchQueries(objects);
+    ReportFrustumCulling(objects);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+// Headless statistics printed by "Graphics --report [asset directories...]"
+void ReportAxisMethods(std::vector<Object>& objects);
+void ReportSpatialSplits(std::vector<Object>& objects);
+void ReportTriangleBLAS(std::vector<Object>& objects);
+void ReportBuildTimes(std::vector<Object>& objects);
+void ReportTreeletOptimization(std::vector<Object>& objects);
+void ReportPLOC(std::vector<Object>& objects);
+void ReportAAC(std::vector<Object>& objects);
+void ReportMergeCosts(std::vector<Object>& objects);
+void ReportFlatTraversal(std::vector<Object>& objects);
+void ReportQuantizedNodes(std::vector<Object>& objects);
+void ReportChildTests(std::vector<Object>& objects);
+void ReportSerialization(std::vector<Object>& objects);
+void ReportNodeOrder(std::vector<Object>& objects);
+void ReportRayQueries(std::vector<Object>& objects);
+void ReportRayPackets(std::vector<Object>& objects);
+void ReportBatchQueries(std::vector<Object>& objects);
+void ReportFrustumCulling(std::vector<Object>& objects);
+
+void RunReports(std::vector<Object>& objects);
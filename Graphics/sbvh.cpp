@@ -0,0 +1,404 @@
+#include "sbvh.h"
+#include <algorithm>
+#include <limits>
+
+#define SBVH_MAX_DEPTH 64
+
+// A triangle reference during the build; bounds shrink as spatial splits clip it
+struct BuildRef {
+    int triangle;
+    AABB bounds;
+};
+
+struct SBVHBuilder {
+    SBVH& sbvh;
+    float rootArea;
+    size_t maxRefs; // Reference count the duplication budget allows
+    size_t numRefs; // References currently alive across the whole build
+};
+
+struct ObjectSplit {
+    float cost;
+    int axis; // -1 if the centroids cannot be separated
+    int bin;
+    float minCentroid;
+    float binScale;
+    AABB left;
+    AABB right;
+};
+
+struct SpatialSplit {
+    float cost;
+    int axis; // -1 if no spatial split was found
+    float position;
+};
+
+static AABB EmptyAABB() {
+    AABB aabb;
+    aabb.min = glm::vec3(std::numeric_limits<float>::max());
+    aabb.max = glm::vec3(std::numeric_limits<float>::lowest());
+    return aabb;
+}
+
+static bool IsValid(const AABB& aabb) {
+    return aabb.min.x <= aabb.max.x && aabb.min.y <= aabb.max.y && aabb.min.z <= aabb.max.z;
+}
+
+// Surface area that treats empty boxes as zero
+static float Area(const AABB& aabb) {
+    return IsValid(aabb) ? SurfaceArea(aabb) : 0.0f;
+}
+
+static float Centroid(const AABB& aabb, int axis) {
+    return (aabb.min[axis] + aabb.max[axis]) * 0.5f;
+}
+
+// Bounds of the part of the triangle that lies between two planes perpendicular to axis
+static AABB ClipTriangleToSlab(const Triangle& tri, int axis, float lo, float hi) {
+    AABB result = EmptyAABB();
+    const glm::vec3 v[3] = { tri.v1, tri.v2, tri.v3 };
+
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec3& a = v[i];
+        const glm::vec3& b = v[(i + 1) % 3];
+
+        if (a[axis] >= lo && a[axis] <= hi) {
+            result.min = glm::min(result.min, a);
+            result.max = glm::max(result.max, a);
+        }
+
+        // Points where the edge crosses either plane
+        for (float plane : { lo, hi }) {
+            if ((a[axis] - plane) * (b[axis] - plane) < 0.0f) {
+                float t = (plane - a[axis]) / (b[axis] - a[axis]);
+                glm::vec3 p = a + (b - a) * t;
+                p[axis] = plane;
+                result.min = glm::min(result.min, p);
+                result.max = glm::max(result.max, p);
+            }
+        }
+    }
+
+    return result;
+}
+
+static ObjectSplit FindObjectSplit(const std::vector<BuildRef>& refs) {
+    ObjectSplit best;
+    best.cost = std::numeric_limits<float>::max();
+    best.axis = -1;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float minC = std::numeric_limits<float>::max();
+        float maxC = std::numeric_limits<float>::lowest();
+        for (const auto& ref : refs) {
+            float c = Centroid(ref.bounds, axis);
+            minC = std::min(minC, c);
+            maxC = std::max(maxC, c);
+        }
+        if (maxC <= minC) continue;
+
+        float scale = SBVH_NUM_BINS / (maxC - minC);
+        AABB bins[SBVH_NUM_BINS];
+        int counts[SBVH_NUM_BINS] = {};
+        for (auto& bin : bins) bin = EmptyAABB();
+        for (const auto& ref : refs) {
+            int bin = std::min(static_cast<int>((Centroid(ref.bounds, axis) - minC) * scale), SBVH_NUM_BINS - 1);
+            counts[bin]++;
+            bins[bin] = MergeAABB(bins[bin], ref.bounds);
+        }
+
+        AABB rightBounds[SBVH_NUM_BINS];
+        int rightCounts[SBVH_NUM_BINS];
+        AABB acc = EmptyAABB();
+        int count = 0;
+        for (int i = SBVH_NUM_BINS - 1; i > 0; --i) {
+            acc = MergeAABB(acc, bins[i]);
+            count += counts[i];
+            rightBounds[i] = acc;
+            rightCounts[i] = count;
+        }
+
+        acc = EmptyAABB();
+        count = 0;
+        for (int i = 0; i < SBVH_NUM_BINS - 1; ++i) {
+            acc = MergeAABB(acc, bins[i]);
+            count += counts[i];
+            if (count == 0 || rightCounts[i + 1] == 0) continue;
+
+            float cost = Area(acc) * count + Area(rightBounds[i + 1]) * rightCounts[i + 1];
+            if (cost < best.cost) {
+                best = { cost, axis, i, minC, scale, acc, rightBounds[i + 1] };
+            }
+        }
+    }
+
+    return best;
+}
+
+static SpatialSplit FindSpatialSplit(const SBVH& sbvh, const std::vector<BuildRef>& refs, const AABB& nodeBounds) {
+    SpatialSplit best;
+    best.cost = std::numeric_limits<float>::max();
+    best.axis = -1;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float lo = nodeBounds.min[axis];
+        float hi = nodeBounds.max[axis];
+        if (hi <= lo) continue;
+
+        float binWidth = (hi - lo) / SBVH_NUM_BINS;
+        AABB bins[SBVH_NUM_BINS];
+        int entries[SBVH_NUM_BINS] = {};
+        int exits[SBVH_NUM_BINS] = {};
+        for (auto& bin : bins) bin = EmptyAABB();
+
+        // Chop every reference into the bins it spans, so each bin only grows by the clipped piece
+        for (const auto& ref : refs) {
+            int first = std::clamp(static_cast<int>((ref.bounds.min[axis] - lo) / binWidth), 0, SBVH_NUM_BINS - 1);
+            int last = std::clamp(static_cast<int>((ref.bounds.max[axis] - lo) / binWidth), first, SBVH_NUM_BINS - 1);
+            entries[first]++;
+            exits[last]++;
+
+            if (first == last) {
+                bins[first] = MergeAABB(bins[first], ref.bounds);
+                continue;
+            }
+            const Triangle& tri = sbvh.triangles[ref.triangle];
+            for (int b = first; b <= last; ++b) {
+                float binLo = lo + b * binWidth;
+                float binHi = (b == SBVH_NUM_BINS - 1) ? hi : lo + (b + 1) * binWidth;
+                AABB piece = IntersectAABB(ClipTriangleToSlab(tri, axis, binLo, binHi), ref.bounds);
+                if (IsValid(piece)) {
+                    bins[b] = MergeAABB(bins[b], piece);
+                }
+            }
+        }
+
+        AABB rightBounds[SBVH_NUM_BINS];
+        int rightCounts[SBVH_NUM_BINS];
+        AABB acc = EmptyAABB();
+        int count = 0;
+        for (int i = SBVH_NUM_BINS - 1; i > 0; --i) {
+            acc = MergeAABB(acc, bins[i]);
+            count += exits[i];
+            rightBounds[i] = acc;
+            rightCounts[i] = count;
+        }
+
+        acc = EmptyAABB();
+        count = 0;
+        for (int i = 0; i < SBVH_NUM_BINS - 1; ++i) {
+            acc = MergeAABB(acc, bins[i]);
+            count += entries[i];
+            if (count == 0 || rightCounts[i + 1] == 0) continue;
+
+            float cost = Area(acc) * count + Area(rightBounds[i + 1]) * rightCounts[i + 1];
+            if (cost < best.cost) {
+                best = { cost, axis, lo + (i + 1) * binWidth };
+            }
+        }
+    }
+
+    return best;
+}
+
+static void PerformSpatialSplit(SBVHBuilder& builder, const std::vector<BuildRef>& refs, const SpatialSplit& split,
+    std::vector<BuildRef>& left, std::vector<BuildRef>& right) {
+    int axis = split.axis;
+    float p = split.position;
+    AABB leftBounds = EmptyAABB();
+    AABB rightBounds = EmptyAABB();
+
+    std::vector<const BuildRef*> straddling;
+    for (const auto& ref : refs) {
+        if (ref.bounds.max[axis] <= p) {
+            left.push_back(ref);
+            leftBounds = MergeAABB(leftBounds, ref.bounds);
+        }
+        else if (ref.bounds.min[axis] >= p) {
+            right.push_back(ref);
+            rightBounds = MergeAABB(rightBounds, ref.bounds);
+        }
+        else {
+            straddling.push_back(&ref);
+        }
+    }
+
+    // Split straddling references in two, unless keeping one whole on a single side is cheaper
+    for (const BuildRef* ref : straddling) {
+        const Triangle& tri = builder.sbvh.triangles[ref->triangle];
+        AABB clippedLeft = IntersectAABB(ClipTriangleToSlab(tri, axis, ref->bounds.min[axis], p), ref->bounds);
+        AABB clippedRight = IntersectAABB(ClipTriangleToSlab(tri, axis, p, ref->bounds.max[axis]), ref->bounds);
+
+        float nl = static_cast<float>(left.size());
+        float nr = static_cast<float>(right.size());
+        float leftOnlyCost = Area(MergeAABB(leftBounds, ref->bounds)) * (nl + 1) + Area(rightBounds) * nr;
+        float rightOnlyCost = Area(leftBounds) * nl + Area(MergeAABB(rightBounds, ref->bounds)) * (nr + 1);
+        float splitCost = std::numeric_limits<float>::max();
+        if (builder.numRefs < builder.maxRefs && IsValid(clippedLeft) && IsValid(clippedRight)) {
+            splitCost = Area(MergeAABB(leftBounds, clippedLeft)) * (nl + 1) + Area(MergeAABB(rightBounds, clippedRight)) * (nr + 1);
+        }
+
+        if (splitCost < leftOnlyCost && splitCost < rightOnlyCost) {
+            left.push_back({ ref->triangle, clippedLeft });
+            right.push_back({ ref->triangle, clippedRight });
+            leftBounds = MergeAABB(leftBounds, clippedLeft);
+            rightBounds = MergeAABB(rightBounds, clippedRight);
+            builder.numRefs++;
+        }
+        else if (leftOnlyCost <= rightOnlyCost) {
+            left.push_back(*ref);
+            leftBounds = MergeAABB(leftBounds, ref->bounds);
+        }
+        else {
+            right.push_back(*ref);
+            rightBounds = MergeAABB(rightBounds, ref->bounds);
+        }
+    }
+}
+
+static void MakeLeaf(SBVH& sbvh, int nodeIndex, const std::vector<BuildRef>& refs) {
+    SBVHNode& node = sbvh.nodes[nodeIndex];
+    node.leftChild = node.rightChild = -1;
+    node.firstRef = sbvh.refs.size();
+    node.numRefs = refs.size();
+    for (const auto& ref : refs) {
+        sbvh.refs.push_back(ref.triangle);
+    }
+}
+
+static void BuildNode(SBVHBuilder& builder, int nodeIndex, std::vector<BuildRef>& refs, int depth) {
+    SBVH& sbvh = builder.sbvh;
+
+    AABB bounds = EmptyAABB();
+    for (const auto& ref : refs) {
+        bounds = MergeAABB(bounds, ref.bounds);
+    }
+    sbvh.nodes[nodeIndex].bounds = bounds;
+
+    if (refs.size() <= SBVH_MAX_LEAF_SIZE || depth >= SBVH_MAX_DEPTH) {
+        MakeLeaf(sbvh, nodeIndex, refs);
+        return;
+    }
+
+    ObjectSplit objectSplit = FindObjectSplit(refs);
+
+    // Only look for a spatial split where the object split leaves the children overlapping
+    SpatialSplit spatialSplit;
+    spatialSplit.cost = std::numeric_limits<float>::max();
+    spatialSplit.axis = -1;
+    if (builder.numRefs < builder.maxRefs) {
+        float overlap = objectSplit.axis >= 0 ? Area(IntersectAABB(objectSplit.left, objectSplit.right)) : Area(bounds);
+        if (overlap > SBVH_OVERLAP_ALPHA * builder.rootArea) {
+            spatialSplit = FindSpatialSplit(sbvh, refs, bounds);
+        }
+    }
+
+    std::vector<BuildRef> left, right;
+    if (spatialSplit.axis >= 0 && spatialSplit.cost < objectSplit.cost) {
+        PerformSpatialSplit(builder, refs, spatialSplit, left, right);
+    }
+    else if (objectSplit.axis >= 0) {
+        for (const auto& ref : refs) {
+            int bin = std::min(static_cast<int>((Centroid(ref.bounds, objectSplit.axis) - objectSplit.minCentroid) * objectSplit.binScale), SBVH_NUM_BINS - 1);
+            (bin <= objectSplit.bin ? left : right).push_back(ref);
+        }
+    }
+
+    if (left.empty() || right.empty()) {
+        // Nothing separates the references, so halve them in their current order
+        left.assign(refs.begin(), refs.begin() + refs.size() / 2);
+        right.assign(refs.begin() + refs.size() / 2, refs.end());
+    }
+
+    // The parent's references are no longer needed once the children own theirs
+    refs.clear();
+    refs.shrink_to_fit();
+
+    int leftIndex = sbvh.nodes.size();
+    sbvh.nodes.resize(sbvh.nodes.size() + 2);
+    sbvh.nodes[nodeIndex].leftChild = leftIndex;
+    sbvh.nodes[nodeIndex].rightChild = leftIndex + 1;
+    sbvh.nodes[nodeIndex].firstRef = 0;
+    sbvh.nodes[nodeIndex].numRefs = 0;
+
+    BuildNode(builder, leftIndex, left, depth + 1);
+    BuildNode(builder, leftIndex + 1, right, depth + 1);
+}
+
+SBVH BuildSBVH(const std::vector<Object>& objects, float duplicationBudget) {
+    SBVH sbvh;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        std::vector<Triangle> triangles = MeshTriangles(objects[i].mesh);
+        sbvh.triangles.insert(sbvh.triangles.end(), triangles.begin(), triangles.end());
+        sbvh.triangleObjects.insert(sbvh.triangleObjects.end(), triangles.size(), static_cast<int>(i));
+    }
+    if (sbvh.triangles.empty()) {
+        return sbvh;
+    }
+
+    std::vector<BuildRef> refs;
+    refs.reserve(sbvh.triangles.size());
+    AABB rootBounds = EmptyAABB();
+    for (size_t i = 0; i < sbvh.triangles.size(); ++i) {
+        AABB bounds = TriangleAABB(sbvh.triangles[i]);
+        refs.push_back({ static_cast<int>(i), bounds });
+        rootBounds = MergeAABB(rootBounds, bounds);
+    }
+
+    size_t maxRefs = refs.size() + static_cast<size_t>(refs.size() * std::max(duplicationBudget, 0.0f));
+    SBVHBuilder builder{ sbvh, SurfaceArea(rootBounds), maxRefs, refs.size() };
+    sbvh.nodes.emplace_back();
+    BuildNode(builder, 0, refs, 0);
+
+    return sbvh;
+}
+
+int SBVHDepth(const SBVH& sbvh, int nodeIndex) {
+    if (sbvh.nodes.empty()) return 0;
+
+    const SBVHNode& node = sbvh.nodes[nodeIndex];
+    if (node.leftChild < 0) return 1;
+    return std::max(SBVHDepth(sbvh, node.leftChild), SBVHDepth(sbvh, node.rightChild)) + 1;
+}
+
+int SBVHRayNodeVisits(const SBVH& sbvh, const Ray& ray, float tMax) {
+    if (sbvh.nodes.empty()) return 0;
+
+    glm::vec3 invDir = 1.0f / ray.direction;
+    int stack[2 * SBVH_MAX_DEPTH + 2];
+    int top = 0;
+    int visits = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const SBVHNode& node = sbvh.nodes[stack[--top]];
+        visits++;
+
+        float tEntry;
+        if (!RayIntersectsAABB(ray, invDir, node.bounds, tMax, tEntry) || node.leftChild < 0) continue;
+        stack[top++] = node.rightChild;
+        stack[top++] = node.leftChild;
+    }
+
+    return visits;
+}
+
+int SBVHOverlapNodeVisits(const SBVH& sbvh, const AABB& box) {
+    if (sbvh.nodes.empty()) return 0;
+
+    int stack[2 * SBVH_MAX_DEPTH + 2];
+    int top = 0;
+    int visits = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const SBVHNode& node = sbvh.nodes[stack[--top]];
+        visits++;
+
+        if (!AABBOverlap(node.bounds, box) || node.leftChild < 0) continue;
+        stack[top++] = node.rightChild;
+        stack[top++] = node.leftChild;
+    }
+
+    return visits;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+
+#define SBVH_MAX_LEAF_SIZE 4
+#define SBVH_NUM_BINS 16
+// Spatial splits are only tried when object-split children overlap by more than this fraction of the root area
+#define SBVH_OVERLAP_ALPHA 1e-5f
+
+struct SBVHNode {
+    AABB bounds;
+    int leftChild;  // -1 for leaves
+    int rightChild;
+    int firstRef;   // Leaves reference refs[firstRef, firstRef + numRefs)
+    int numRefs;
+};
+
+// Spatial-split BVH over the scene's triangles. A triangle straddling a spatial
+// split is referenced by both children, clipped to each side's bounds.
+struct SBVH {
+    std::vector<Triangle> triangles;  // Every mesh triangle in the scene
+    std::vector<int> triangleObjects; // Index of the Object each triangle came from
+    std::vector<SBVHNode> nodes;      // nodes[0] is the root
+    std::vector<int> refs;            // Triangle indices referenced by leaves, may repeat
+};
+
+// duplicationBudget bounds the extra references as a fraction of the triangle count;
+// a budget of 0 disables spatial splits and gives a plain binned SAH tree over triangles
+SBVH BuildSBVH(const std::vector<Object>& objects, float duplicationBudget = 0.3f);
+
+int SBVHDepth(const SBVH& sbvh, int nodeIndex = 0);
+int SBVHRayNodeVisits(const SBVH& sbvh, const Ray& ray, float tMax);
+int SBVHOverlapNodeVisits(const SBVH& sbvh, const AABB& box);
@@ -0,0 +1,165 @@
+#include "trbvh.h"
+#include "parallel.h"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <unordered_map>
+
+struct TreeletPass {
+    std::unordered_map<const TreeNode*, float> costs; // SAH cost sum of every subtree, before dividing by the root's area
+    std::vector<std::vector<TreeNode*>> levels;       // Internal nodes grouped by height above the leaves
+};
+
+static bool IsBinary(const TreeNode* node) {
+    return node->type == INTERNAL && node->numChildren == 2;
+}
+
+// Records each subtree's cost and returns the node's height
+static int GatherNodes(TreeNode* node, TreeletPass& pass) {
+    float area = SurfaceArea(node->aabbVolume);
+    if (node->type == LEAF) {
+        pass.costs[node] = area * node->numObjects * SAH_INTERSECTION_COST;
+        return 0;
+    }
+
+    int height = 0;
+    float cost = area * SAH_TRAVERSAL_COST;
+    for (int i = 0; i < node->numChildren; ++i) {
+        height = std::max(height, GatherNodes(node->children[i], pass) + 1);
+        cost += pass.costs[node->children[i]];
+    }
+    pass.costs[node] = cost;
+
+    if (static_cast<int>(pass.levels.size()) <= height) {
+        pass.levels.resize(height + 1);
+    }
+    pass.levels[height].push_back(node);
+    return height;
+}
+
+struct Treelet {
+    TreeNode* leaves[TRBVH_MAX_TREELET_LEAVES];
+    TreeNode* internals[TRBVH_MAX_TREELET_LEAVES - 1];
+    int numLeaves = 0;
+    int numInternals = 0;
+
+    // DP tables indexed by leaf subset
+    AABB bounds[1 << TRBVH_MAX_TREELET_LEAVES];
+    float cost[1 << TRBVH_MAX_TREELET_LEAVES];
+    int split[1 << TRBVH_MAX_TREELET_LEAVES];
+};
+
+// Rebuilds the subtree for a leaf subset from the DP table, reusing the treelet's internal nodes in order
+static TreeNode* BuildTreelet(Treelet& treelet, int subset, int& nextInternal, TreeletPass& pass) {
+    if (std::has_single_bit(static_cast<unsigned>(subset))) {
+        return treelet.leaves[std::countr_zero(static_cast<unsigned>(subset))];
+    }
+
+    TreeNode* node = treelet.internals[nextInternal++];
+    TreeNode* left = BuildTreelet(treelet, treelet.split[subset], nextInternal, pass);
+    TreeNode* right = BuildTreelet(treelet, subset ^ treelet.split[subset], nextInternal, pass);
+    node->children[0] = left;
+    node->children[1] = right;
+    if (node != treelet.internals[0]) {
+        // The treelet root covers the same leaves as before, so its volumes (and its ancestors') stay valid
+        node->objects = nullptr;
+        node->numObjects = left->numObjects + right->numObjects;
+        node->aabbVolume = MergeAABB(left->aabbVolume, right->aabbVolume);
+        node->ritterVolume = MergeBoundingSpheres(left->ritterVolume, right->ritterVolume);
+        node->larssonVolume = MergeBoundingSpheres(left->larssonVolume, right->larssonVolume);
+        node->pcaVolume = MergeBoundingSpheres(left->pcaVolume, right->pcaVolume);
+    }
+    node->UpdateChildBounds();
+    pass.costs.find(node)->second = treelet.cost[subset];
+    return node;
+}
+
+static void RestructureTreelet(TreeNode* root, int treeletLeaves, TreeletPass& pass) {
+    // Children were processed first, so refresh this node's cost from theirs
+    float rootCost = SurfaceArea(root->aabbVolume) * SAH_TRAVERSAL_COST;
+    for (int i = 0; i < root->numChildren; ++i) {
+        rootCost += pass.costs.find(root->children[i])->second;
+    }
+    pass.costs.find(root)->second = rootCost;
+    if (!IsBinary(root)) return;
+
+    Treelet treelet;
+    treelet.internals[treelet.numInternals++] = root;
+    treelet.leaves[treelet.numLeaves++] = root->children[0];
+    treelet.leaves[treelet.numLeaves++] = root->children[1];
+
+    // Grow the treelet by opening the leaf with the largest surface area
+    while (treelet.numLeaves < treeletLeaves) {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int i = 0; i < treelet.numLeaves; ++i) {
+            if (IsBinary(treelet.leaves[i])) {
+                float area = SurfaceArea(treelet.leaves[i]->aabbVolume);
+                if (area > bestArea) {
+                    bestArea = area;
+                    best = i;
+                }
+            }
+        }
+        if (best < 0) break;
+
+        TreeNode* opened = treelet.leaves[best];
+        treelet.internals[treelet.numInternals++] = opened;
+        treelet.leaves[best] = opened->children[0];
+        treelet.leaves[treelet.numLeaves++] = opened->children[1];
+    }
+    if (treelet.numLeaves < 3) return; // Only one arrangement
+
+    // Subsets only split into numerically smaller subsets, so increasing order visits parts first
+    int fullSet = (1 << treelet.numLeaves) - 1;
+    for (int subset = 1; subset <= fullSet; ++subset) {
+        int lowest = subset & -subset;
+        if (subset == lowest) {
+            int leaf = std::countr_zero(static_cast<unsigned>(subset));
+            treelet.bounds[subset] = treelet.leaves[leaf]->aabbVolume;
+            treelet.cost[subset] = pass.costs.find(treelet.leaves[leaf])->second;
+            continue;
+        }
+        treelet.bounds[subset] = MergeAABB(treelet.bounds[subset ^ lowest], treelet.bounds[lowest]);
+
+        // Each partition once: the left part always holds the lowest leaf
+        float bestCost = std::numeric_limits<float>::max();
+        int bestSplit = lowest;
+        for (int part = (subset - 1) & subset; part > 0; part = (part - 1) & subset) {
+            if (!(part & lowest)) continue;
+            float cost = treelet.cost[part] + treelet.cost[subset ^ part];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = part;
+            }
+        }
+        treelet.cost[subset] = SurfaceArea(treelet.bounds[subset]) * SAH_TRAVERSAL_COST + bestCost;
+        treelet.split[subset] = bestSplit;
+    }
+
+    const float EPSILON = 1e-6f;
+    if (treelet.cost[fullSet] >= rootCost * (1.0f - EPSILON)) return;
+
+    int nextInternal = 0;
+    BuildTreelet(treelet, fullSet, nextInternal, pass);
+}
+
+void OptimizeTreelets(TreeNode* root, int treeletLeaves, int passes) {
+    if (!root || root->type == LEAF) return;
+    treeletLeaves = std::clamp(treeletLeaves, 3, TRBVH_MAX_TREELET_LEAVES);
+
+    for (int p = 0; p < passes && !BuildCancelled(); ++p) {
+        TreeletPass pass;
+        GatherNodes(root, pass);
+        float before = pass.costs[root];
+
+        for (auto& level : pass.levels) {
+            if (BuildCancelled()) return;
+            ParallelFor(0, static_cast<int>(level.size()), [&](int i) {
+                RestructureTreelet(level[i], treeletLeaves, pass);
+                }, 64);
+        }
+
+        if (pass.costs[root] >= before) break; // Converged
+    }
+}
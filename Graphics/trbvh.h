@@ -0,0 +1,15 @@
+#pragma once
+#include "bvh.h"
+
+// Leaves per treelet; the optimal arrangement is searched over all 2^n subsets
+#define TRBVH_TREELET_LEAVES 7
+#define TRBVH_MAX_TREELET_LEAVES 8
+#define TRBVH_PASSES 3
+
+// Treelet restructuring (Karras & Aila 2013). Every binary internal node grows a
+// treelet by repeatedly opening its largest-area leaf, then the treelet's internal
+// nodes are rearranged into the topology with the lowest SAH cost found by dynamic
+// programming over subsets of its leaves. Nodes are processed bottom-up, and nodes
+// of equal height are processed in parallel since their subtrees are disjoint.
+// Works on the output of any builder; nodes with more than two children are left as they are.
+void OptimizeTreelets(TreeNode* root, int treeletLeaves = TRBVH_TREELET_LEAVES, int passes = TRBVH_PASSES);